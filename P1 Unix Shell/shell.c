@@ -8,243 +8,2480 @@
 // This file implements the UNIX-like shell interface.
 // It provides constants, data structures, and function prototypes to support:
 // - Interactive command execution with background processes (&)
+// - Non-interactive execution of -c strings and script files
 // - Input/output redirection (< and >)
 // - Command piping (|)
 // - Command history (!!)
-// - Built-in test cases
+// - Builtins (cd, pwd, echo, export, exit, jobs, ...) without forking
+// - time prefix and opt-in per-command telemetry
+// - @cpu=, @nice= and resource-limit launch prefixes
+// - Per-stage pipeline throughput tap (set -o tap)
+// - Spawn-latency and pipe-throughput benchmark suite
 // - ASCII art Easter egg
 // - Error handling for invalid commands
 // ---------------------------------------------------------------------------------
 
 #include "shell.h"
 
+// Exit status of the most recent foreground command or pipeline
+static int last_status = 0;
+
+// True while reading commands from a terminal prompt
+static bool interactive = false;
+
+// Set by the exit builtin; stops the current line and the input loop
+static bool exit_requested = false;
+
 // ----------------------- int main(int argc, char **argv) ----------------------
 // Purpose:
-// - Launches interactive mode if --interactive flag is written,
-//   otherwise runs built-in test cases.
+// - Launches interactive mode if --interactive flag is written,
+//   runs "osh -c 'command'", "osh script" or the benchmark suite
+//   ("osh --bench [samples]"); anything else prints usage and exits 2.
+// Parameters:
+// - argc - num of command-line arguments
+// - argv - array of command-line argument strings
+// ------------------------------------------------------------------------------
+int main(int argc, char **argv) {
+  jobs_init();
+  if (argc == 2 && equal(argv[1], "--interactive")) {
+    return interactiveShell();
+  } else if (argc >= 3 && equal(argv[1], "-c")) {
+    return runCommand(argv[2]);
+  } else if (argc >= 2 && argv[1][0] != '-') {
+    return runScript(argv[1]);
+  } else if (argc >= 2 && equal(argv[1], "--bench")) {
+    return runBench(argc >= 3 ? atoi(argv[2]) : BENCH_SAMPLES);
+  } else {
+    fprintf(stderr, "usage: osh --interactive | -c command | script | "
+                    "--bench [samples]\n");
+    return 2;
+  }
+}
+
+// --------------------------- void print_ascii_art() ---------------------------
+// Purpose:
+// - Displays ASCII art for the "ascii" command.
+// ------------------------------------------------------------------------------
+void print_ascii_art() {
+  printf("  |\\_/|        ****************************    (\\_/)\n");
+  printf(" / @ @ \\       *  \"Purrrfectly pleasant\"  *   (='.'=)\n");
+  printf("( > º < )      *       Poppy Prinz        *   (\")_(\")\n");
+  printf(" `>>x<<´       *   (pprinz@example.com)   *\n");
+  printf(" /  O  \\       ****************************\n");
+}
+
+// ------------------------------ Command hash table ------------------------------
+// Maps a command name to the absolute path it resolved to, like sh's "hash".
+// Filled lazily on first use and thrown away whenever $PATH changes, so a
+// cached command costs one posix_spawn (one execve) instead of one failed
+// execve per $PATH directory in front of it.
+// --------------------------------------------------------------------------------
+static HashEntry *path_cache[HASH_BUCKETS];
+static char *cached_path_var = NULL; // value of $PATH the cache was built for
+
+// -------------------- static unsigned hash_name(char *name) ---------------------
+// Purpose:
+// - FNV-1a hash of a command name
+// --------------------------------------------------------------------------------
+static unsigned hash_name(char *name) {
+  unsigned h = 2166136261u;
+  for (; *name; name++) {
+    h = (h ^ (unsigned char)*name) * 16777619u;
+  }
+  return h % HASH_BUCKETS;
+}
+
+// ---------------------------- void path_cache_clear() ---------------------------
+// Purpose:
+// - Forgets every remembered command path ("hash -r")
+// --------------------------------------------------------------------------------
+void path_cache_clear() {
+  for (int b = 0; b < HASH_BUCKETS; b++) {
+    HashEntry *e = path_cache[b];
+    while (e) {
+      HashEntry *next = e->next;
+      free(e->name);
+      free(e->path);
+      free(e);
+      e = next;
+    }
+    path_cache[b] = NULL;
+  }
+}
+
+// ----------------------- void path_cache_forget(char *name) ---------------------
+// Purpose:
+// - Drops one entry, e.g. after the cached file disappeared
+// Parameters:
+// - name - command name to forget
+// --------------------------------------------------------------------------------
+void path_cache_forget(char *name) {
+  HashEntry **link = &path_cache[hash_name(name)];
+  while (*link) {
+    HashEntry *e = *link;
+    if (equal(e->name, name)) {
+      *link = e->next;
+      free(e->name);
+      free(e->path);
+      free(e);
+      return;
+    }
+    link = &e->next;
+  }
+}
+
+// ------------------------ static char *search_path(char *name) ------------------
+// Purpose:
+// - Walks $PATH once and returns the first executable regular file
+// Parameters:
+// - name - command name without a '/'
+// Returns:
+// - malloc'ed absolute path, or NULL if not found
+// --------------------------------------------------------------------------------
+static char *search_path(char *name) {
+  char *path_var = getenv("PATH");
+  if (path_var == NULL) path_var = "/usr/local/bin:/usr/bin:/bin";
+
+  size_t name_len = strlen(name);
+  char *dir = path_var;
+  while (true) {
+    char *end = strchr(dir, ':');
+    size_t dir_len = end ? (size_t)(end - dir) : strlen(dir);
+
+    // An empty $PATH element means the current directory
+    char *candidate = malloc(dir_len + name_len + 3);
+    if (dir_len == 0) {
+      sprintf(candidate, "./%s", name);
+    } else {
+      memcpy(candidate, dir, dir_len);
+      candidate[dir_len] = '/';
+      memcpy(candidate + dir_len + 1, name, name_len + 1);
+    }
+
+    struct stat st;
+    if (stat(candidate, &st) == 0 && S_ISREG(st.st_mode) &&
+        access(candidate, X_OK) == 0) {
+      return candidate;
+    }
+    free(candidate);
+
+    if (end == NULL) return NULL;
+    dir = end + 1;
+  }
+}
+
+// ----------------------- char *path_cache_lookup(char *name) --------------------
+// Purpose:
+// - Returns the absolute path for a command, resolving and remembering it
+//   on a miss; names containing '/' are used as given
+// - Clears the table first if $PATH no longer matches what it was built for
+// Parameters:
+// - name - command name (argv[0])
+// Returns:
+// - path owned by the cache (or name itself), or NULL if not found
+// --------------------------------------------------------------------------------
+char *path_cache_lookup(char *name) {
+  if (strchr(name, '/')) return name;
+
+  char *path_var = getenv("PATH");
+  if (path_var == NULL) path_var = "";
+  if (cached_path_var == NULL || !equal(cached_path_var, path_var)) {
+    path_cache_clear();
+    free(cached_path_var);
+    cached_path_var = strdup(path_var);
+  }
+
+  unsigned b = hash_name(name);
+  for (HashEntry *e = path_cache[b]; e; e = e->next) {
+    if (equal(e->name, name)) {
+      e->hits++;
+      return e->path;
+    }
+  }
+
+  char *path = search_path(name);
+  if (path == NULL) return NULL;
+  HashEntry *e = malloc(sizeof(HashEntry));
+  e->name = strdup(name);
+  e->path = path;
+  e->hits = 1;
+  e->next = path_cache[b];
+  path_cache[b] = e;
+  return path;
+}
+
+// ------------------------- int builtin_hash(char **argv) ------------------------
+// Purpose:
+// - "hash" lists remembered commands with their hit counts
+// - "hash -r" forgets them all
+// - "hash name..." resolves and remembers the given commands
+// Parameters:
+// - argv - NULL-terminated arguments, argv[0] is "hash"
+// Returns:
+// - 0 on success, 1 if a named command was not found
+// --------------------------------------------------------------------------------
+int builtin_hash(char **argv) {
+  if (argv[1] == NULL) {
+    bool empty = true;
+    for (int b = 0; b < HASH_BUCKETS; b++) {
+      for (HashEntry *e = path_cache[b]; e; e = e->next) {
+        if (empty) printf("hits\tcommand\n");
+        printf("%4d\t%s\n", e->hits, e->path);
+        empty = false;
+      }
+    }
+    if (empty) printf("hash: hash table empty\n");
+    return 0;
+  }
+
+  if (equal(argv[1], "-r")) {
+    path_cache_clear();
+    return 0;
+  }
+
+  int status = 0;
+  for (int i = 1; argv[i] != NULL; i++) {
+    if (path_cache_lookup(argv[i]) == NULL) {
+      fprintf(stderr, "osh: hash: %s: not found\n", argv[i]);
+      status = 1;
+    }
+  }
+  return status;
+}
+
+// ---------------------------------- Job table -----------------------------------
+// Every child the shell starts belongs to a job (one per command or pipeline).
+// SIGCHLD reaps children as soon as they exit and records the result in the
+// table; the table itself is only modified with SIGCHLD blocked, so the
+// handler always sees it in a consistent state. Foreground commands are
+// waited for with sigsuspend() on their job, background jobs are reported
+// at the next prompt.
+// --------------------------------------------------------------------------------
+static Job **job_table = NULL; // slot i holds job %i+1, or NULL
+static int job_slots = 0;
+static sigset_t shell_sigmask; // signal mask the shell normally runs with
+static volatile sig_atomic_t jobs_finished = 0; // bg jobs done, not yet reported
+
+// ------------------------------ int decode_status(int) --------------------------
+// Purpose:
+// - Converts a wait status to a shell exit status
+// Parameters:
+// - wstatus - status as returned by waitpid
+// Returns:
+// - exit code, or 128 + signal number if the child was killed
+// --------------------------------------------------------------------------------
+int decode_status(int wstatus) {
+  if (WIFEXITED(wstatus)) return WEXITSTATUS(wstatus);
+  if (WIFSIGNALED(wstatus)) return 128 + WTERMSIG(wstatus);
+  return 0;
+}
+
+// -------------------------- static void sigchld_handler(int) --------------------
+// Purpose:
+// - Reaps every child that has exited without blocking and marks its stage
+//   as finished in the job table, keeping the rusage wait4() reports
+// --------------------------------------------------------------------------------
+static void sigchld_handler(int sig) {
+  (void)sig;
+  int saved_errno = errno;
+  int wstatus;
+  struct rusage ru;
+  pid_t pid;
+  while ((pid = wait4(-1, &wstatus, WNOHANG, &ru)) > 0) {
+    for (int j = 0; j < job_slots; j++) {
+      Job *job = job_table[j];
+      if (job == NULL) continue;
+      for (int s = 0; s < job->num_pids; s++) {
+        if (job->pids[s] != pid) continue;
+        job->pids[s] = 0;
+        job->alive--;
+        usage_add(&job->usage, &ru);
+        if (s == job->num_pids - 1) job->status = decode_status(wstatus);
+        if (job->alive == 0) {
+          clock_gettime(CLOCK_MONOTONIC, &job->usage.finished);
+          if (job->background) jobs_finished++;
+        }
+      }
+    }
+  }
+  errno = saved_errno;
+}
+
+// --------------------------------- void jobs_init() -----------------------------
+// Purpose:
+// - Installs the SIGCHLD handler; called once at startup
+// --------------------------------------------------------------------------------
+void jobs_init() {
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = sigchld_handler;
+  sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGCHLD, &sa, NULL);
+  sigprocmask(SIG_SETMASK, NULL, &shell_sigmask);
+}
+
+// ----------------------------- void block_sigchld(bool) -------------------------
+// Purpose:
+// - Blocks or unblocks SIGCHLD around job table updates
+// Parameters:
+// - block - true to block, false to restore the shell's normal mask
+// --------------------------------------------------------------------------------
+void block_sigchld(bool block) {
+  if (block) {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &set, NULL);
+  } else {
+    sigprocmask(SIG_SETMASK, &shell_sigmask, NULL);
+  }
+}
+
+// ------------------- Job *job_create(int num_pids, char *text, bool bg) ---------
+// Purpose:
+// - Allocates a job in the lowest free slot; caller has SIGCHLD blocked
+// Parameters:
+// - num_pids - number of stages the job will have
+// - text - command line to show in notices (taken over), may be NULL
+// - background - whether the job runs in the background
+// --------------------------------------------------------------------------------
+Job *job_create(int num_pids, char *text, bool background) {
+  int slot = 0;
+  while (slot < job_slots && job_table[slot] != NULL) slot++;
+  if (slot == job_slots) {
+    int new_slots = job_slots ? job_slots * 2 : 8;
+    job_table = realloc(job_table, new_slots * sizeof(Job *));
+    for (int j = job_slots; j < new_slots; j++) job_table[j] = NULL;
+    job_slots = new_slots;
+  }
+
+  Job *job = malloc(sizeof(Job));
+  job->id = slot + 1;
+  job->text = text;
+  job->pids = calloc(num_pids, sizeof(pid_t));
+  job->num_pids = num_pids;
+  job->alive = 0;
+  job->status = 0;
+  job->background = background;
+  job->timed = false;
+  memset(&job->usage, 0, sizeof(job->usage));
+  clock_gettime(CLOCK_MONOTONIC, &job->usage.started);
+  job_table[slot] = job;
+  return job;
+}
+
+// ---------------------- void job_set_pid(Job *job, int s, pid_t) ----------------
+// Purpose:
+// - Records the child started for stage s; a failed start (pid < 0) counts
+//   as an immediately finished stage with status 127
+// --------------------------------------------------------------------------------
+void job_set_pid(Job *job, int s, pid_t pid) {
+  if (pid > 0) {
+    job->pids[s] = pid;
+    job->alive++;
+  } else if (s == job->num_pids - 1) {
+    job->status = STATUS_NOT_FOUND;
+  }
+}
+
+// ------------------------------ void job_remove(Job *job) -----------------------
+// Purpose:
+// - Frees a job and its slot; caller has SIGCHLD blocked
+// - A job that ran to completion first gets its "time" report and its
+//   telemetry record
+// --------------------------------------------------------------------------------
+void job_remove(Job *job) {
+  if (job->alive == 0 && job->usage.finished.tv_sec != 0) {
+    if (job->timed) print_usage(&job->usage);
+    telemetry_record(job->text, &job->usage, job->status);
+  }
+  job_table[job->id - 1] = NULL;
+  free(job->text);
+  free(job->pids);
+  free(job);
+}
+
+// ------------------------------ Job *job_find(int id) ---------------------------
+// Purpose:
+// - Returns job %id, or NULL if there is none
+// --------------------------------------------------------------------------------
+Job *job_find(int id) {
+  if (id < 1 || id > job_slots) return NULL;
+  return job_table[id - 1];
+}
+
+// ------------------------------ int job_wait(Job *job) --------------------------
+// Purpose:
+// - Sleeps until every stage of the job has been reaped, then removes it
+// - Caller has SIGCHLD blocked; sigsuspend() atomically unblocks it
+// Returns:
+// - exit status of the job's last stage
+// --------------------------------------------------------------------------------
+int job_wait(Job *job) {
+  while (job->alive > 0) sigsuspend(&shell_sigmask);
+  int status = job->status;
+  job_remove(job);
+  return status;
+}
+
+// --------------------------- void job_notify(bool report) ----------------------
+// Purpose:
+// - Drops every background job that finished since the last call from the
+//   table, printing a notice for each one if asked to
+// - Returns at once when SIGCHLD has not finished any background job, so
+//   scripts can call it after every line
+// Parameters:
+// - report - print "[n]  Done ..." lines (interactive prompt)
+// --------------------------------------------------------------------------------
+void job_notify(bool report) {
+  if (jobs_finished == 0) return;
+  block_sigchld(true);
+  jobs_finished = 0;
+  for (int j = 0; j < job_slots; j++) {
+    Job *job = job_table[j];
+    if (job == NULL || job->alive > 0 || !job->background) continue;
+    if (!report) {
+      // quiet
+    } else if (job->status == 0) {
+      printf("[%d]  Done\t\t%s\n", job->id, job->text);
+    } else {
+      printf("[%d]  Exit %d\t\t%s\n", job->id, job->status, job->text);
+    }
+    job_remove(job);
+  }
+  block_sigchld(false);
+}
+
+// ---------------------- static Job *parse_job_spec(char *spec) ------------------
+// Purpose:
+// - Resolves "%n" to job n; NULL spec means the most recent job
+// --------------------------------------------------------------------------------
+static Job *parse_job_spec(char *spec) {
+  if (spec == NULL) {
+    for (int j = job_slots - 1; j >= 0; j--) {
+      if (job_table[j]) return job_table[j];
+    }
+    return NULL;
+  }
+  if (spec[0] == '%') spec++;
+  return job_find(atoi(spec));
+}
+
+// ------------------------------ int builtin_jobs(char **argv) -------------------
+// Purpose:
+// - "jobs" lists background jobs with their state
+// --------------------------------------------------------------------------------
+int builtin_jobs(char **argv) {
+  (void)argv;
+  block_sigchld(true);
+  for (int j = 0; j < job_slots; j++) {
+    Job *job = job_table[j];
+    if (job == NULL || !job->background) continue;
+    printf("[%d]  %s\t\t%s\n", job->id, job->alive > 0 ? "Running" : "Done",
+           job->text);
+  }
+  block_sigchld(false);
+  return 0;
+}
+
+// ------------------------------ int builtin_wait(char **argv) -------------------
+// Purpose:
+// - "wait" waits for every background job
+// - "wait %n" waits for job n and returns its status
+// --------------------------------------------------------------------------------
+int builtin_wait(char **argv) {
+  int status = 0;
+  block_sigchld(true);
+  if (argv[1] == NULL) {
+    for (int j = 0; j < job_slots; j++) {
+      Job *job = job_table[j];
+      if (job && job->background) status = job_wait(job);
+    }
+  } else {
+    for (int i = 1; argv[i] != NULL; i++) {
+      Job *job = parse_job_spec(argv[i]);
+      if (job == NULL) {
+        fprintf(stderr, "osh: wait: %s: no such job\n", argv[i]);
+        status = STATUS_NOT_FOUND;
+        continue;
+      }
+      status = job_wait(job);
+    }
+  }
+  block_sigchld(false);
+  return status;
+}
+
+// ------------------------------ int builtin_fg(char **argv) ---------------------
+// Purpose:
+// - "fg [%n]" resumes a background job (SIGCONT) and waits for it in the
+//   foreground; without an argument it takes the most recent job
+// --------------------------------------------------------------------------------
+int builtin_fg(char **argv) {
+  block_sigchld(true);
+  Job *job = parse_job_spec(argv[1]);
+  if (job == NULL) {
+    block_sigchld(false);
+    fprintf(stderr, "osh: fg: %s: no such job\n", argv[1] ? argv[1] : "current");
+    return 1;
+  }
+  printf("%s\n", job->text ? job->text : "");
+  fflush(stdout);
+  job->background = false;
+  for (int s = 0; s < job->num_pids; s++) {
+    if (job->pids[s] > 0) kill(job->pids[s], SIGCONT);
+  }
+  int status = job_wait(job);
+  block_sigchld(false);
+  return status;
+}
+
+// -------------------------------- Per-line arena --------------------------------
+// Tokens, words, argv arrays and segments of one input line are carved out of
+// a chain of blocks that is rewound (not freed) before the next line, so a
+// line costs no malloc/free once the arena has grown to fit it.
+// --------------------------------------------------------------------------------
+static Arena line_arena = {NULL, NULL};
+
+// -------------------- void *arena_alloc(Arena *arena, size_t n) -----------------
+// Purpose:
+// - Returns n bytes from the arena, aligned for any type; adds a block (at
+//   least twice the previous one) when the current chain is exhausted
+// Parameters:
+// - arena - arena to allocate from
+// - n - number of bytes
+// --------------------------------------------------------------------------------
+void *arena_alloc(Arena *arena, size_t n) {
+  n = (n + 15) & ~(size_t)15;
+  ArenaBlock *block = arena->current;
+  while (block && block->used + n > block->size) {
+    block = block->next;
+    if (block) block->used = 0;
+  }
+  if (block == NULL) {
+    size_t size = arena->current ? arena->current->size * 2 : ARENA_BLOCK;
+    if (size < n) size = n;
+    block = malloc(sizeof(ArenaBlock) + size);
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    if (arena->current) {
+      // Append after the last block so a rewind walks the whole chain again
+      ArenaBlock *tail = arena->current;
+      while (tail->next) tail = tail->next;
+      tail->next = block;
+    } else {
+      arena->head = block;
+    }
+  }
+  arena->current = block;
+  void *p = block->data + block->used;
+  block->used += n;
+  return p;
+}
+
+// ----------------------- void arena_reset(Arena *arena) -------------------------
+// Purpose:
+// - Makes every block of the arena available again; nothing is freed
+// --------------------------------------------------------------------------------
+void arena_reset(Arena *arena) {
+  arena->current = arena->head;
+  if (arena->head) arena->head->used = 0;
+}
+
+// ------------------- static char *arena_strndup(Arena *, char *, size_t) --------
+// Purpose:
+// - Copies n bytes of s into the arena as a NUL-terminated string
+// --------------------------------------------------------------------------------
+static char *arena_strndup(Arena *arena, char *s, size_t n) {
+  char *copy = arena_alloc(arena, n + 1);
+  memcpy(copy, s, n);
+  copy[n] = '\0';
+  return copy;
+}
+
+// ---------------- static char *pattern_put(char *pattern, char c, bool) ----------
+// Purpose:
+// - Appends c to a glob pattern, escaping it if it was quoted and would
+//   otherwise be a wildcard
+// Returns:
+// - the new end of the pattern
+// --------------------------------------------------------------------------------
+static char *pattern_put(char *pattern, char c, bool quoted) {
+  if (quoted && strchr("*?[]\\", c)) *pattern++ = '\\';
+  *pattern++ = c;
+  return pattern;
+}
+
+// ------------------------ Token *lex(char *line, int *count) --------------------
+// Purpose:
+// - Splits a line into words and the operators | & ; < > in one pass
+// - A # at the start of a word begins a comment
+// - Operators need no surrounding blanks; inside '...' everything is
+//   literal, inside "..." a backslash only escapes " \ $ and `, and a bare
+//   backslash escapes the next character
+// - Quoted operator characters stay part of a word
+// - A word with an unquoted * ? or [ also gets a glob pattern, in which its
+//   quoted characters are escaped so they match literally
+// Parameters:
+// - line - input line (not modified)
+// - count - receives the number of tokens
+// Returns:
+// - array of tokens in the line arena, or NULL on an unterminated quote
+// --------------------------------------------------------------------------------
+Token *lex(char *line, int *count) {
+  size_t line_len = strlen(line);
+
+  // No line can hold more tokens than bytes + 1, and no word is longer than
+  // the line; sizing both up front keeps this a single pass with no regrowth
+  Token *tokens = arena_alloc(&line_arena, (line_len + 1) * sizeof(Token));
+  char *words = arena_alloc(&line_arena, line_len + 1);
+  char *patterns = arena_alloc(&line_arena, 2 * line_len + 1); // worst case: all escaped
+  int n = 0;
+
+  char *p = line;
+  while (true) {
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++;
+    if (*p == '\0' || *p == '#') break; // # at a word start comments out the rest
+
+    Token *tok = &tokens[n++];
+    tok->start = p - line;
+    tok->pattern = NULL;
+    if (strchr("|&;<>", *p)) {
+      tok->type = *p == '|' ? TOK_PIPE : *p == '&' ? TOK_AMP :
+                  *p == ';' ? TOK_SEMI : *p == '<' ? TOK_LESS : TOK_GREAT;
+      tok->text = NULL;
+      p++;
+      tok->end = p - line;
+      continue;
+    }
+
+    // A word runs until an unquoted blank or operator
+    tok->type = TOK_WORD;
+    tok->text = words;
+    char *pattern = patterns;
+    bool wildcard = false;
+    while (*p && !strchr(" \t\n\r|&;<>", *p)) {
+      if (*p == '\'') {
+        char *close = strchr(p + 1, '\'');
+        if (close == NULL) goto unterminated;
+        for (p++; p < close; p++) {
+          *words++ = *p;
+          pattern = pattern_put(pattern, *p, true);
+        }
+        p = close + 1;
+      } else if (*p == '"') {
+        p++;
+        while (*p != '"') {
+          if (*p == '\0') goto unterminated;
+          if (*p == '\\' && p[1] && strchr("\"\\$`", p[1])) p++;
+          pattern = pattern_put(pattern, *p, true);
+          *words++ = *p++;
+        }
+        p++;
+      } else if (*p == '\\' && p[1]) {
+        *words++ = p[1];
+        pattern = pattern_put(pattern, p[1], true);
+        p += 2;
+      } else {
+        if (*p == '*' || *p == '?' || *p == '[') wildcard = true;
+        pattern = pattern_put(pattern, *p, false);
+        *words++ = *p++;
+      }
+    }
+    *words++ = '\0';
+    if (wildcard) {
+      *pattern++ = '\0';
+      tok->pattern = patterns;
+      patterns = pattern;
+    }
+    tok->end = p - line;
+  }
+  *count = n;
+  return tokens;
+
+unterminated:
+  fprintf(stderr, "osh: syntax error: unterminated quote\n");
+  return NULL;
+}
+
+// ------------------------------ Wildcard expansion ------------------------------
+// Patterns are matched one path component at a time against directory
+// listings read with getdents64(). A listing is kept, sorted, in one of
+// DIR_CACHE_SLOTS slots and reused while the directory's device, inode and
+// mtime are unchanged, so a repeated glob over a 100k-entry directory costs a
+// stat() and a binary search on the literal prefix instead of a rescan.
+// A pattern that matches nothing is left as typed.
+// --------------------------------------------------------------------------------
+static DirCache dir_cache[DIR_CACHE_SLOTS];
+static unsigned long dir_cache_tick = 0;
+static char *dirent_buffer = NULL; // DIR_READ_BUFFER bytes, reused by every scan
+static char **glob_paths = NULL; // matches of the pattern being expanded
+static int glob_count = 0, glob_capacity = 0;
+
+// ---------------------- static int compare_names(a, b) --------------------------
+// Purpose:
+// - qsort comparator for an array of names
+// --------------------------------------------------------------------------------
+static int compare_names(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// ------------------------ static void dir_cache_free(DirCache *) ----------------
+// Purpose:
+// - Releases a cached listing and marks its slot free
+// --------------------------------------------------------------------------------
+static void dir_cache_free(DirCache *cache) {
+  free(cache->path);
+  free(cache->names);
+  free(cache->entries);
+  memset(cache, 0, sizeof(DirCache));
+}
+
+// -------------------- static bool dir_read(DirCache *, char *dir) ---------------
+// Purpose:
+// - Reads every name of dir except . and .. with getdents64() and sorts them
+// - Names are packed into one buffer, each preceded by its d_type byte
+// Returns:
+// - false if the directory cannot be read
+// --------------------------------------------------------------------------------
+static bool dir_read(DirCache *cache, char *dir) {
+  int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) return false;
+  if (dirent_buffer == NULL) dirent_buffer = malloc(DIR_READ_BUFFER);
+
+  size_t capacity = DIR_READ_BUFFER, used = 0;
+  char *names = malloc(capacity);
+  int count = 0;
+  long n;
+  while ((n = syscall(SYS_getdents64, fd, dirent_buffer, DIR_READ_BUFFER)) > 0) {
+    for (long offset = 0; offset < n;) {
+      Dirent64 *d = (Dirent64 *)(dirent_buffer + offset);
+      offset += d->d_reclen;
+      char *name = d->d_name;
+      if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+      size_t len = strlen(name) + 2; // type byte + name + NUL
+      if (used + len > capacity) {
+        capacity *= 2;
+        names = realloc(names, capacity);
+      }
+      names[used] = d->d_type;
+      memcpy(names + used + 1, name, len - 1);
+      used += len;
+      count++;
+    }
+  }
+  close(fd);
+  if (n < 0) {
+    free(names);
+    return false;
+  }
+
+  // Pointers are taken only now, once names has stopped moving
+  char **entries = malloc((count + 1) * sizeof(char *));
+  size_t offset = 0;
+  for (int i = 0; i < count; i++) {
+    entries[i] = names + offset + 1;
+    offset += strlen(entries[i]) + 2;
+  }
+  qsort(entries, count, sizeof(char *), compare_names);
+  cache->names = names;
+  cache->entries = entries;
+  cache->count = count;
+  return true;
+}
+
+// ------------------------- static DirCache *dir_cache_get(char *dir) -------------
+// Purpose:
+// - Returns the sorted listing of dir, from the cache when the directory is
+//   unchanged since it was read, otherwise by rescanning it into its own
+//   slot or the least recently used one
+// - A listing read within DIR_RACY_NS of the directory's mtime is not
+//   trusted: a later change in the same timestamp tick would leave mtime as
+//   it is
+// - Slots with a positive pin count are in use by an outer glob level and
+//   are neither evicted nor rescanned
+// Returns:
+// - the listing, or NULL if dir is not a readable directory or all slots
+//   are pinned
+// --------------------------------------------------------------------------------
+static DirCache *dir_cache_get(char *dir) {
+  struct stat st;
+  if (stat(dir, &st) < 0 || !S_ISDIR(st.st_mode)) return NULL;
+
+  DirCache *slot = NULL, *victim = NULL;
+  for (int i = 0; i < DIR_CACHE_SLOTS; i++) {
+    DirCache *cache = &dir_cache[i];
+    if (cache->path && equal(cache->path, dir)) {
+      slot = cache;
+      break;
+    }
+    if (cache->pins == 0 && (victim == NULL || cache->last_used < victim->last_used)) {
+      victim = cache;
+    }
+  }
+  if (slot && (slot->pins > 0 ||
+               (!slot->racy && slot->dev == st.st_dev && slot->ino == st.st_ino &&
+                slot->mtime.tv_sec == st.st_mtim.tv_sec &&
+                slot->mtime.tv_nsec == st.st_mtim.tv_nsec))) {
+    slot->last_used = ++dir_cache_tick;
+    return slot;
+  }
+  if (slot == NULL) slot = victim;
+  if (slot == NULL) return NULL;
+
+  dir_cache_free(slot);
+  if (!dir_read(slot, dir)) return NULL;
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  slot->path = strdup(dir);
+  slot->dev = st.st_dev;
+  slot->ino = st.st_ino;
+  slot->mtime = st.st_mtim;
+  slot->racy = (now.tv_sec - st.st_mtim.tv_sec) * 1000000000LL +
+               (now.tv_nsec - st.st_mtim.tv_nsec) < DIR_RACY_NS;
+  slot->last_used = ++dir_cache_tick;
+  return slot;
+}
+
+// ------------------------- static bool glob_magic(char *component) --------------
+// Purpose:
+// - Tells whether a pattern component has an unescaped * or ?, or a [ that
+//   is closed later; anything else names exactly one file
+// --------------------------------------------------------------------------------
+static bool glob_magic(char *component) {
+  for (char *c = component; *c; c++) {
+    if (*c == '\\') {
+      if (c[1]) c++;
+    } else if (*c == '*' || *c == '?' || (*c == '[' && strchr(c + 1, ']'))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// ---------------------- static void glob_add(char *path, size_t len) -----------
+// Purpose:
+// - Copies a match into the line arena and appends it to glob_paths
+// --------------------------------------------------------------------------------
+static void glob_add(char *path, size_t len) {
+  if (glob_count == glob_capacity) {
+    glob_capacity = glob_capacity ? glob_capacity * 2 : 64;
+    glob_paths = realloc(glob_paths, glob_capacity * sizeof(char *));
+  }
+  glob_paths[glob_count++] = arena_strndup(&line_arena, path, len);
+}
+
+// -------------------- static void glob_walk(char *, size_t, char *) -------------
+// Purpose:
+// - Matches the first component of rest inside the directory path[0..len)
+//   and recurses into matching directories for the remaining components
+// - A literal component is appended without reading the directory; the
+//   finished path is checked with lstat()
+// Parameters:
+// - path - PATH_MAX buffer holding the directory so far, "" or ending in /
+// - len - length of that directory
+// - rest - remaining pattern components
+// --------------------------------------------------------------------------------
+static void glob_walk(char *path, size_t len, char *rest) {
+  while (*rest == '/') rest++;
+  char *slash = strchr(rest, '/');
+  size_t component_len = slash ? (size_t)(slash - rest) : strlen(rest);
+  char *component = arena_strndup(&line_arena, rest, component_len);
+
+  if (!glob_magic(component)) {
+    size_t n = len;
+    for (char *c = component; *c; c++) {
+      if (*c == '\\' && c[1]) c++;
+      if (n + 2 >= PATH_MAX) return;
+      path[n++] = *c;
+    }
+    if (slash == NULL) {
+      struct stat st;
+      path[n] = '\0';
+      if (lstat(path, &st) == 0) glob_add(path, n);
+      return;
+    }
+    path[n++] = '/';
+    glob_walk(path, n, slash + 1);
+    return;
+  }
+
+  path[len] = '\0';
+  DirCache *dir = dir_cache_get(len ? path : ".");
+  if (dir == NULL) return;
+
+  // Entries are sorted, so only the run sharing the literal prefix is tried
+  char *prefix = arena_alloc(&line_arena, component_len + 1);
+  size_t prefix_len = 0;
+  for (char *c = component; *c && !strchr("*?[", *c); c++) {
+    if (*c == '\\' && c[1]) c++;
+    prefix[prefix_len++] = *c;
+  }
+  prefix[prefix_len] = '\0';
+  int lo = 0, hi = dir->count;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (strcmp(dir->entries[mid], prefix) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  dir->pins++;
+  for (int i = lo; i < dir->count; i++) {
+    char *name = dir->entries[i];
+    if (strncmp(name, prefix, prefix_len) != 0) break;
+    if (fnmatch(component, name, FNM_PERIOD) != 0) continue;
+    size_t name_len = strlen(name);
+    if (len + name_len + 2 >= PATH_MAX) continue;
+    memcpy(path + len, name, name_len);
+    if (slash == NULL) {
+      glob_add(path, len + name_len);
+      continue;
+    }
+    unsigned char type = name[-1];
+    if (type != DT_DIR && type != DT_LNK && type != DT_UNKNOWN) continue;
+    path[len + name_len] = '/';
+    glob_walk(path, len + name_len + 1, slash + 1);
+  }
+  dir->pins--;
+}
+
+// -------------------- char **glob_expand(char *pattern, int *count) ------------
+// Purpose:
+// - Expands a glob pattern (* ? [...], backslash escapes) to the sorted
+//   list of existing paths it matches; a leading . must be matched
+//   explicitly
+// Parameters:
+// - pattern - pattern from lex()
+// - count - receives the number of matches
+// Returns:
+// - array of paths in the line arena, or NULL if nothing matched
+// --------------------------------------------------------------------------------
+char **glob_expand(char *pattern, int *count) {
+  char path[PATH_MAX];
+  size_t len = 0;
+  if (pattern[0] == '/') path[len++] = '/';
+  glob_count = 0;
+  glob_walk(path, len, pattern);
+
+  *count = glob_count;
+  if (glob_count == 0) return NULL;
+  char **matches = arena_alloc(&line_arena, glob_count * sizeof(char *));
+  memcpy(matches, glob_paths, glob_count * sizeof(char *));
+  return matches;
+}
+
+// -------------------- static bool glob_redirect(char **file, char *) ----------
+// Purpose:
+// - Replaces a redirection target by the one path its pattern matches
+// Returns:
+// - false after reporting a pattern that matches several paths
+// --------------------------------------------------------------------------------
+static bool glob_redirect(char **file, char *pattern) {
+  if (pattern == NULL) return true;
+  int count;
+  char **matches = glob_expand(pattern, &count);
+  if (count > 1) {
+    fprintf(stderr, "osh: %s: ambiguous redirect\n", *file);
+    return false;
+  }
+  if (count == 1) *file = matches[0];
+  return true;
+}
+
+// ------------------------- bool glob_segment(Segment *seg) ----------------------
+// Purpose:
+// - Expands the glob words of every stage right before the segment runs,
+//   so a pattern sees files created by earlier segments of the same line
+// - Each matching word is replaced by its matches; the new argv lives in
+//   the line arena
+// Returns:
+// - false after reporting an ambiguous redirect
+// --------------------------------------------------------------------------------
+bool glob_segment(Segment *seg) {
+  for (int s = 0; s < seg->num_stages; s++) {
+    Command *cmd = &seg->stages[s];
+    if (!glob_redirect(&cmd->input_file, cmd->input_pattern) ||
+        !glob_redirect(&cmd->output_file, cmd->output_pattern)) {
+      return false;
+    }
+    if (cmd->patterns == NULL) continue;
+
+    int argc = 0;
+    while (cmd->argv[argc]) argc++;
+    char ***matches = arena_alloc(&line_arena, argc * sizeof(char **));
+    int *counts = arena_alloc(&line_arena, argc * sizeof(int));
+    int total = 0;
+    for (int i = 0; i < argc; i++) {
+      counts[i] = 0;
+      if (cmd->patterns[i]) matches[i] = glob_expand(cmd->patterns[i], &counts[i]);
+      total += counts[i] ? counts[i] : 1;
+    }
+
+    char **argv = arena_alloc(&line_arena, (total + 1) * sizeof(char *));
+    int n = 0;
+    for (int i = 0; i < argc; i++) {
+      if (counts[i] == 0) {
+        argv[n++] = cmd->argv[i];
+      } else {
+        memcpy(argv + n, matches[i], counts[i] * sizeof(char *));
+        n += counts[i];
+      }
+    }
+    argv[n] = NULL;
+    cmd->argv = argv;
+  }
+  return true;
+}
+
+// ------------------ Segment *parse(char *line, int *num_segments) ----------------
+// Purpose:
+// - Lexes a line and groups its tokens into segments separated by ; or &,
+//   each holding one or more pipeline stages with their redirections
+// - Glob patterns are recorded next to their words; glob_segment()
+//   expands them when the segment runs
+// - All argv arrays, stages and segments live in the line arena
+// Parameters:
+// - line - input line
+// - num_segments - receives the number of segments
+// Returns:
+// - array of segments, or NULL after reporting a syntax error
+// --------------------------------------------------------------------------------
+Segment *parse(char *line, int *num_segments) {
+  int count;
+  Token *tokens = lex(line, &count);
+  if (tokens == NULL) return NULL;
+
+  // Upper bound: every separator may end a segment
+  int max_segments = 1;
+  for (int t = 0; t < count; t++) {
+    if (tokens[t].type == TOK_SEMI || tokens[t].type == TOK_AMP) max_segments++;
+  }
+  Segment *segments = arena_alloc(&line_arena, max_segments * sizeof(Segment));
+  int n = 0;
+
+  int t = 0;
+  while (t < count) {
+    // Find the end of the current segment and count its stages
+    int start = t, num_stages = 1;
+    while (t < count && tokens[t].type != TOK_SEMI && tokens[t].type != TOK_AMP) {
+      if (tokens[t].type == TOK_PIPE) num_stages++;
+      t++;
+    }
+    int end = t;
+    bool background = t < count && tokens[t].type == TOK_AMP;
+    if (t < count) t++;
+    if (start == end) {
+      if (background) {
+        fprintf(stderr, "osh: syntax error near &\n");
+        return NULL;
+      }
+      continue; // empty segment, e.g. "ls ;;"
+    }
+
+    // A leading "time" reports the resources of the whole segment
+    bool timed = tokens[start].type == TOK_WORD && equal(tokens[start].text, "time") &&
+                 start + 1 < end;
+    if (timed) start++;
+
+    Segment *seg = &segments[n++];
+    seg->stages = arena_alloc(&line_arena, num_stages * sizeof(Command));
+    seg->num_stages = num_stages;
+    seg->background = background;
+    seg->timed = timed;
+    seg->text = arena_strndup(&line_arena, line + tokens[start].start,
+                              tokens[end - 1].end - tokens[start].start);
+
+    // Fill each stage: words go to argv, < and > take the following word
+    int s = 0, i = start;
+    while (s < num_stages) {
+      int words = 0;
+      int stage_end = i;
+      while (stage_end < end && tokens[stage_end].type != TOK_PIPE) {
+        if (tokens[stage_end].type == TOK_WORD) words++;
+        stage_end++;
+      }
+
+      Command *cmd = &seg->stages[s];
+      cmd->argv = arena_alloc(&line_arena, (words + 1) * sizeof(char *));
+      cmd->input_file = NULL;
+      cmd->output_file = NULL;
+      cmd->limits = NULL;
+      cmd->patterns = NULL;
+      cmd->input_pattern = NULL;
+      cmd->output_pattern = NULL;
+      int argc = 0;
+      for (; i < stage_end; i++) {
+        if (tokens[i].type == TOK_WORD) {
+          // @name=value words before the command are launch prefixes
+          char *word = tokens[i].text;
+          if (argc == 0 && word[0] == '@' && strchr(word, '=')) {
+            if (cmd->limits == NULL) {
+              cmd->limits = arena_alloc(&line_arena, sizeof(Limits));
+              memset(cmd->limits, 0, sizeof(Limits));
+            }
+            if (!parse_limit(cmd->limits, word)) return NULL;
+            continue;
+          }
+          if (tokens[i].pattern) {
+            if (cmd->patterns == NULL) {
+              cmd->patterns = arena_alloc(&line_arena, (words + 1) * sizeof(char *));
+              memset(cmd->patterns, 0, (words + 1) * sizeof(char *));
+            }
+            cmd->patterns[argc] = tokens[i].pattern;
+          }
+          cmd->argv[argc++] = word;
+          continue;
+        }
+        if (i + 1 >= stage_end || tokens[i + 1].type != TOK_WORD) {
+          fprintf(stderr, "osh: syntax error: missing file after %c\n",
+                  tokens[i].type == TOK_LESS ? '<' : '>');
+          return NULL;
+        }
+        if (tokens[i].type == TOK_LESS) {
+          cmd->input_file = tokens[i + 1].text;
+          cmd->input_pattern = tokens[i + 1].pattern;
+        } else {
+          cmd->output_file = tokens[i + 1].text;
+          cmd->output_pattern = tokens[i + 1].pattern;
+        }
+        i++;
+      }
+      cmd->argv[argc] = NULL;
+      if (argc == 0) {
+        fprintf(stderr, "osh: syntax error: missing command\n");
+        return NULL;
+      }
+      i = stage_end + 1;
+      s++;
+    }
+  }
+  *num_segments = n;
+  return segments;
+}
+
+// --------------------------------- Line reader ----------------------------------
+// Streams lines from a file descriptor through one large buffer. Lines are cut
+// in place at '\n', so a line costs no read() and no copy; the buffer only
+// grows for a line longer than itself. Reading the fd directly (not through
+// stdio) keeps it independent of whatever the shell has buffered on stdin.
+// --------------------------------------------------------------------------------
+
+// ------------------- void line_reader_init(LineReader *r, int fd) ---------------
+// Purpose:
+// - Prepares a reader for fd; the reader does not take ownership of fd
+// --------------------------------------------------------------------------------
+void line_reader_init(LineReader *reader, int fd) {
+  reader->fd = fd;
+  reader->capacity = SCRIPT_BUFFER;
+  reader->buffer = malloc(reader->capacity + 1); // + 1 for a final line without '\n'
+  reader->start = 0;
+  reader->len = 0;
+  reader->eof = false;
+}
+
+// -------------------- char *line_reader_next(LineReader *reader) ----------------
+// Purpose:
+// - Returns the next line without its '\n'; it stays valid until the next call
+// Returns:
+// - the line, or NULL at end of input
+// --------------------------------------------------------------------------------
+char *line_reader_next(LineReader *reader) {
+  while (true) {
+    char *start = reader->buffer + reader->start;
+    char *newline = memchr(start, '\n', reader->len - reader->start);
+    if (newline) {
+      *newline = '\0';
+      reader->start = newline + 1 - reader->buffer;
+      return start;
+    }
+    if (reader->eof) {
+      if (reader->start == reader->len) return NULL;
+      reader->buffer[reader->len] = '\0';
+      reader->start = reader->len;
+      return start;
+    }
+
+    // Keep the partial line at the front and read more behind it
+    reader->len -= reader->start;
+    memmove(reader->buffer, start, reader->len);
+    reader->start = 0;
+    if (reader->len == reader->capacity) {
+      reader->capacity *= 2;
+      reader->buffer = realloc(reader->buffer, reader->capacity + 1);
+    }
+    ssize_t n = read(reader->fd, reader->buffer + reader->len,
+                     reader->capacity - reader->len);
+    if (n == -1 && errno == EINTR) continue;
+    if (n == -1) perror("read");
+    if (n <= 0) reader->eof = true;
+    else reader->len += n;
+  }
+}
+
+// -------------------- void line_reader_free(LineReader *reader) -----------------
+// Purpose:
+// - Releases the reader's buffer
+// --------------------------------------------------------------------------------
+void line_reader_free(LineReader *reader) {
+  free(reader->buffer);
+  reader->buffer = NULL;
+}
+
+// ------------------------------ Resource telemetry ------------------------------
+// Every job records its start time, the time its last stage was reaped and
+// the rusage wait4() returned for each stage. "time" prints that record for
+// one command or pipeline; "set -o telemetry" appends one line per command to
+// a log file and keeps per-command latency histograms for "stats".
+// --------------------------------------------------------------------------------
+static bool opt_telemetry = false;  // set -o telemetry
+static bool opt_tap = false;        // set -o tap, see "Pipeline tap"
+static int telemetry_fd = -1;       // log file, opened on first use
+static CommandStats *session_stats[HASH_BUCKETS];
+
+// Options understood by "set -o"
+static ShellOption options[] = {
+  {"tap", &opt_tap},
+  {"telemetry", &opt_telemetry},
+};
+
+// --------------------- static long elapsed_us(struct timespec *, *) -------------
+// Purpose:
+// - Microseconds between two CLOCK_MONOTONIC readings
+// --------------------------------------------------------------------------------
+static long elapsed_us(struct timespec *from, struct timespec *to) {
+  return (to->tv_sec - from->tv_sec) * 1000000L + (to->tv_nsec - from->tv_nsec) / 1000;
+}
+
+// ----------------------------- static long tv_us(struct timeval *) --------------
+// Purpose:
+// - Converts an rusage time to microseconds
+// --------------------------------------------------------------------------------
+static long tv_us(struct timeval *tv) {
+  return tv->tv_sec * 1000000L + tv->tv_usec;
+}
+
+// --------------------------- void usage_add(JobUsage *, struct rusage *) --------
+// Purpose:
+// - Folds one reaped stage into a job's usage: times and context switches
+//   add up, max RSS is that of the largest stage
+// - Called from the SIGCHLD handler, so it only touches the job
+// --------------------------------------------------------------------------------
+void usage_add(JobUsage *usage, struct rusage *ru) {
+  timeradd(&usage->rusage.ru_utime, &ru->ru_utime, &usage->rusage.ru_utime);
+  timeradd(&usage->rusage.ru_stime, &ru->ru_stime, &usage->rusage.ru_stime);
+  if (ru->ru_maxrss > usage->rusage.ru_maxrss) usage->rusage.ru_maxrss = ru->ru_maxrss;
+  usage->rusage.ru_nvcsw += ru->ru_nvcsw;
+  usage->rusage.ru_nivcsw += ru->ru_nivcsw;
+}
+
+// ----------------------------- void print_usage(JobUsage *usage) ---------------
+// Purpose:
+// - Prints the "time" report on stderr
+// --------------------------------------------------------------------------------
+void print_usage(JobUsage *usage) {
+  fflush(stdout); // the report follows the command's own output
+  long real = elapsed_us(&usage->started, &usage->finished);
+  fprintf(stderr, "real\t%ld.%06lds\n", real / 1000000, real % 1000000);
+  fprintf(stderr, "user\t%ld.%06lds\n", (long)usage->rusage.ru_utime.tv_sec,
+          (long)usage->rusage.ru_utime.tv_usec);
+  fprintf(stderr, "sys\t%ld.%06lds\n", (long)usage->rusage.ru_stime.tv_sec,
+          (long)usage->rusage.ru_stime.tv_usec);
+  fprintf(stderr, "maxrss\t%ld KB\n", usage->rusage.ru_maxrss);
+  fprintf(stderr, "csw\t%ld voluntary, %ld involuntary\n",
+          usage->rusage.ru_nvcsw, usage->rusage.ru_nivcsw);
+}
+
+// ------------------ static void stats_add(CommandStats **, char *, long) --------
+// Purpose:
+// - Adds one latency sample to the histogram of the named command
+// Parameters:
+// - table - hash table of per-command histograms
+// - name - command name (first word of the command line)
+// - real_us - wall-clock latency in microseconds
+// --------------------------------------------------------------------------------
+static void stats_add(CommandStats **table, char *name, long real_us) {
+  unsigned b = hash_name(name);
+  CommandStats *cs = table[b];
+  while (cs && !equal(cs->name, name)) cs = cs->next;
+  if (cs == NULL) {
+    cs = calloc(1, sizeof(CommandStats));
+    cs->name = strdup(name);
+    cs->next = table[b];
+    table[b] = cs;
+  }
+
+  // Bucket i holds latencies in [2^i, 2^(i+1)) microseconds
+  int bucket = 0;
+  while (bucket < STATS_BUCKETS - 1 && (1L << (bucket + 1)) <= real_us) bucket++;
+  cs->buckets[bucket]++;
+  cs->count++;
+  cs->total_us += real_us;
+  if (real_us > cs->max_us) cs->max_us = real_us;
+}
+
+// ------------------------ static void stats_clear(CommandStats **) --------------
+// Purpose:
+// - Frees every histogram in a table
+// --------------------------------------------------------------------------------
+static void stats_clear(CommandStats **table) {
+  for (int b = 0; b < HASH_BUCKETS; b++) {
+    while (table[b]) {
+      CommandStats *next = table[b]->next;
+      free(table[b]->name);
+      free(table[b]);
+      table[b] = next;
+    }
+  }
+}
+
+// -------------------------- static char *command_name(char *text) ---------------
+// Purpose:
+// - Copies the first word of a command line into buf
+// --------------------------------------------------------------------------------
+static char *command_name(char *text, char *buf, size_t size) {
+  size_t n = strcspn(text, " \t");
+  if (n >= size) n = size - 1;
+  memcpy(buf, text, n);
+  buf[n] = '\0';
+  return buf;
+}
+
+// ------------------ void telemetry_record(char *text, JobUsage *, int) ----------
+// Purpose:
+// - Appends one tab-separated record to the telemetry log and updates the
+//   session histograms:
+//   epoch_ms real_us user_us sys_us maxrss_kb nvcsw nivcsw status command
+// - The record goes out in a single write() so concurrent shells can share
+//   a log opened with O_APPEND
+// Parameters:
+// - text - command line
+// - usage - resources the command used
+// - status - its exit status
+// --------------------------------------------------------------------------------
+void telemetry_record(char *text, JobUsage *usage, int status) {
+  if (!opt_telemetry || text == NULL) return;
+  if (telemetry_fd == -1) {
+    char *path = getenv("OSH_TELEMETRY_LOG");
+    if (path == NULL) path = TELEMETRY_LOG;
+    telemetry_fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (telemetry_fd == -1) {
+      fprintf(stderr, "osh: telemetry: %s: %s\n", path, strerror(errno));
+      opt_telemetry = false;
+      return;
+    }
+  }
+
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  long real = elapsed_us(&usage->started, &usage->finished);
+  // Numbers first into a stack buffer, then the command line after them
+  char head[256];
+  int head_len = snprintf(head, sizeof(head), "%ld\t%ld\t%ld\t%ld\t%ld\t%ld\t%ld\t%d\t",
+                          (long)now.tv_sec * 1000 + now.tv_nsec / 1000000, real,
+                          tv_us(&usage->rusage.ru_utime), tv_us(&usage->rusage.ru_stime),
+                          usage->rusage.ru_maxrss, usage->rusage.ru_nvcsw,
+                          usage->rusage.ru_nivcsw, status);
+  size_t text_len = strlen(text);
+  size_t len = head_len + text_len + 1;
+  char stack_record[1024];
+  char *record = len <= sizeof(stack_record) ? stack_record : malloc(len);
+  memcpy(record, head, head_len);
+  memcpy(record + head_len, text, text_len);
+  record[len - 1] = '\n';
+  if (write(telemetry_fd, record, len) == -1) {
+    fprintf(stderr, "osh: telemetry: %s\n", strerror(errno));
+  }
+  if (record != stack_record) free(record);
+
+  char name[256];
+  stats_add(session_stats, command_name(text, name, sizeof(name)), real);
+}
+
+// --------------------- static void stats_print(CommandStats **) ----------------
+// Purpose:
+// - Prints count, mean and max latency and a log2 histogram per command
+// --------------------------------------------------------------------------------
+static void stats_print(CommandStats **table) {
+  for (int b = 0; b < HASH_BUCKETS; b++) {
+    for (CommandStats *cs = table[b]; cs; cs = cs->next) {
+      printf("%s: %ld runs, mean %.3f ms, max %.3f ms\n", cs->name, cs->count,
+             cs->total_us / cs->count / 1000.0, cs->max_us / 1000.0);
+      long peak = 0;
+      for (int i = 0; i < STATS_BUCKETS; i++) {
+        if (cs->buckets[i] > peak) peak = cs->buckets[i];
+      }
+      for (int i = 0; i < STATS_BUCKETS; i++) {
+        if (cs->buckets[i] == 0) continue;
+        int bar = (int)(cs->buckets[i] * 40 / peak);
+        printf("  < %10.3f ms |%-40.*s| %ld\n", (1L << (i + 1)) / 1000.0, bar,
+               "########################################", cs->buckets[i]);
+      }
+    }
+  }
+}
+
+// ----------------------------- int builtin_stats(char **argv) -------------------
+// Purpose:
+// - "stats" prints latency histograms for this session's commands
+// - "stats file" builds them from a telemetry log instead
+// - "stats -r" forgets the session's samples
+// --------------------------------------------------------------------------------
+int builtin_stats(char **argv) {
+  if (argv[1] == NULL) {
+    stats_print(session_stats);
+    return 0;
+  }
+  if (equal(argv[1], "-r")) {
+    stats_clear(session_stats);
+    return 0;
+  }
+
+  int fd = open(argv[1], O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    fprintf(stderr, "osh: stats: %s: %s\n", argv[1], strerror(errno));
+    return 1;
+  }
+  CommandStats *table[HASH_BUCKETS] = {NULL};
+  LineReader reader;
+  line_reader_init(&reader, fd);
+  char *line, name[256];
+  while ((line = line_reader_next(&reader)) != NULL) {
+    // real_us is the second field, the command line the ninth
+    char *field = line;
+    long real = -1;
+    for (int f = 0; f < 8 && field; f++) {
+      if (f == 1) real = atol(field);
+      field = strchr(field, '\t');
+      if (field) field++;
+    }
+    if (field && real >= 0) stats_add(table, command_name(field, name, sizeof(name)), real);
+  }
+  line_reader_free(&reader);
+  close(fd);
+  stats_print(table);
+  stats_clear(table);
+  return 0;
+}
+
+// ------------------------------ int builtin_set(char **argv) --------------------
+// Purpose:
+// - "set -o name" turns a shell option on, "set +o name" turns it off
+// - "set -o" alone lists the options
+// --------------------------------------------------------------------------------
+int builtin_set(char **argv) {
+  size_t num_options = sizeof(options) / sizeof(options[0]);
+  if (argv[1] == NULL || argv[2] == NULL) {
+    for (size_t i = 0; i < num_options; i++) {
+      printf("%-12s %s\n", options[i].name, *options[i].value ? "on" : "off");
+    }
+    return 0;
+  }
+
+  bool on = equal(argv[1], "-o");
+  if (!on && !equal(argv[1], "+o")) {
+    fprintf(stderr, "usage: set [-o|+o] option\n");
+    return 2;
+  }
+  for (size_t i = 0; i < num_options; i++) {
+    if (equal(options[i].name, argv[2])) {
+      *options[i].value = on;
+      return 0;
+    }
+  }
+  fprintf(stderr, "osh: set: %s: invalid option name\n", argv[2]);
+  return 1;
+}
+
+// ------------------------------ Launch prefixes ---------------------------------
+// Words like @cpu=0-3 @nice=5 @nofile=256 in front of a command (or of any
+// pipeline stage) set CPU affinity, scheduling priority and resource limits
+// for that child only. They are applied in the child between vfork()/fork()
+// and execve(), which saves the extra exec of wrapping commands in taskset
+// or nice. Stages without prefixes still go through posix_spawn.
+// --------------------------------------------------------------------------------
+
+// Resource limits accepted as @name=value
+static struct {
+  char *name;
+  int resource;
+} rlimit_names[] = {
+  {"as", RLIMIT_AS},         {"core", RLIMIT_CORE},     {"cpu-time", RLIMIT_CPU},
+  {"data", RLIMIT_DATA},     {"fsize", RLIMIT_FSIZE},   {"nofile", RLIMIT_NOFILE},
+  {"nproc", RLIMIT_NPROC},   {"stack", RLIMIT_STACK},
+};
+
+// ---------------------- static bool parse_cpu_list(char *, cpu_set_t *) ---------
+// Purpose:
+// - Parses "0-3,6,8-9" into a CPU set
+// --------------------------------------------------------------------------------
+static bool parse_cpu_list(char *list, cpu_set_t *cpus) {
+  CPU_ZERO(cpus);
+  char *p = list;
+  while (*p) {
+    char *end;
+    long first = strtol(p, &end, 10);
+    long last = first;
+    if (end == p) return false;
+    if (*end == '-') {
+      p = end + 1;
+      last = strtol(p, &end, 10);
+      if (end == p) return false;
+    }
+    if (first < 0 || last < first || last >= CPU_SETSIZE) return false;
+    for (long cpu = first; cpu <= last; cpu++) CPU_SET(cpu, cpus);
+    if (*end == ',') end++;
+    else if (*end != '\0') return false;
+    p = end;
+  }
+  return CPU_COUNT(cpus) > 0;
+}
+
+// ---------------------- static bool parse_size(char *, rlim_t *) ----------------
+// Purpose:
+// - Parses a limit value with an optional K/M/G suffix, or "unlimited"
+// --------------------------------------------------------------------------------
+static bool parse_size(char *text, rlim_t *value) {
+  if (equal(text, "unlimited")) {
+    *value = RLIM_INFINITY;
+    return true;
+  }
+  char *end;
+  unsigned long long n = strtoull(text, &end, 10);
+  if (end == text) return false;
+  switch (*end) {
+    case 'G': case 'g': n <<= 10; // fall through
+    case 'M': case 'm': n <<= 10; // fall through
+    case 'K': case 'k': n <<= 10; end++; break;
+  }
+  if (*end != '\0') return false;
+  *value = n;
+  return true;
+}
+
+// ------------------- bool parse_limit(Limits *limits, char *word) ---------------
+// Purpose:
+// - Adds one @name=value prefix to a stage's launch settings
 // Parameters:
-// - argc - num of command-line arguments
-// - argv - array of command-line argument strings
-// ------------------------------------------------------------------------------
-int main(int argc, char **argv) {
-  if (argc == 2 && equal(argv[1], "--interactive")) {
-    return interactiveShell();
+// - limits - settings to update
+// - word - prefix word including the '@'
+// Returns:
+// - false (after reporting it) if the name or value is invalid
+// --------------------------------------------------------------------------------
+bool parse_limit(Limits *limits, char *word) {
+  char *eq = strchr(word, '=');
+  size_t name_len = eq - word - 1;
+  char *value = eq + 1;
+  bool ok = false;
+
+  if (name_len == 3 && strncmp(word + 1, "cpu", 3) == 0) {
+    ok = parse_cpu_list(value, &limits->cpus);
+    limits->has_affinity = ok;
+  } else if (name_len == 4 && strncmp(word + 1, "nice", 4) == 0) {
+    char *end;
+    limits->nice = strtol(value, &end, 10);
+    ok = end != value && *end == '\0';
+    limits->has_nice = ok;
   } else {
-    return runTests();
+    for (size_t i = 0; i < sizeof(rlimit_names) / sizeof(rlimit_names[0]); i++) {
+      if (strlen(rlimit_names[i].name) != name_len ||
+          strncmp(word + 1, rlimit_names[i].name, name_len) != 0) {
+        continue;
+      }
+      rlim_t n;
+      if (!parse_size(value, &n) || limits->num_rlimits == MAX_RLIMITS) break;
+      limits->rlimits[limits->num_rlimits].resource = rlimit_names[i].resource;
+      limits->rlimits[limits->num_rlimits].limit.rlim_cur = n;
+      limits->rlimits[limits->num_rlimits].limit.rlim_max = n;
+      limits->num_rlimits++;
+      ok = true;
+      break;
+    }
   }
+  if (!ok) fprintf(stderr, "osh: %s: invalid launch prefix\n", word);
+  return ok;
 }
 
-// --------------------------- void print_ascii_art() ---------------------------
+// ----------------------- static void child_error(char *, int) -------------------
 // Purpose:
-// - Displays ASCII art for the "ascii" command.
+// - Reports a failure from a vfork()ed child using only write()
+// --------------------------------------------------------------------------------
+static void child_error(char *what, int err) {
+  char *msg = strerror(err);
+  write(STDERR_FILENO, "osh: ", 5);
+  write(STDERR_FILENO, what, strlen(what));
+  write(STDERR_FILENO, ": ", 2);
+  write(STDERR_FILENO, msg, strlen(msg));
+  write(STDERR_FILENO, "\n", 1);
+}
+
+// --------------------------- int apply_limits(Limits *limits) -------------------
+// Purpose:
+// - Applies affinity, nice value and rlimits to the calling (child) process;
+//   only makes system calls, so it is safe between vfork() and execve()
+// Returns:
+// - 0 on success, -1 after reporting the failing setting
+// --------------------------------------------------------------------------------
+int apply_limits(Limits *limits) {
+  if (limits->has_affinity &&
+      sched_setaffinity(0, sizeof(cpu_set_t), &limits->cpus) == -1) {
+    child_error("@cpu", errno);
+    return -1;
+  }
+  if (limits->has_nice && setpriority(PRIO_PROCESS, 0, limits->nice) == -1) {
+    child_error("@nice", errno);
+    return -1;
+  }
+  for (int i = 0; i < limits->num_rlimits; i++) {
+    if (setrlimit(limits->rlimits[i].resource, &limits->rlimits[i].limit) == -1) {
+      child_error("rlimit", errno);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// ---------------------------------- Builtins ------------------------------------
+// Commands the shell runs itself. A builtin that is a whole foreground
+// command runs in-process with its redirections applied to the shell's own
+// stdin/stdout; in a pipeline or in the background it runs in a forked child.
+// --------------------------------------------------------------------------------
+
+// -------------------------- int builtin_ascii(char **argv) ----------------------
+// Purpose:
+// - "ascii" prints the ASCII art Easter egg
+// --------------------------------------------------------------------------------
+int builtin_ascii(char **argv) {
+  (void)argv;
+  print_ascii_art();
+  return 0;
+}
+
+// ---------------------------- int builtin_cd(char **argv) -----------------------
+// Purpose:
+// - "cd [dir]" changes the shell's directory; no argument means $HOME and
+//   "-" means $OLDPWD; keeps $PWD and $OLDPWD up to date
+// --------------------------------------------------------------------------------
+int builtin_cd(char **argv) {
+  char *dir = argv[1];
+  if (dir == NULL) dir = getenv("HOME");
+  else if (equal(dir, "-")) dir = getenv("OLDPWD");
+  if (dir == NULL) {
+    fprintf(stderr, "osh: cd: %s not set\n", argv[1] ? "OLDPWD" : "HOME");
+    return 1;
+  }
+
+  char *old = getcwd(NULL, 0);
+  if (chdir(dir) == -1) {
+    fprintf(stderr, "osh: cd: %s: %s\n", dir, strerror(errno));
+    free(old);
+    return 1;
+  }
+  if (argv[1] && equal(argv[1], "-")) printf("%s\n", dir);
+  if (old) setenv("OLDPWD", old, 1);
+  free(old);
+  char *cwd = getcwd(NULL, 0);
+  if (cwd) setenv("PWD", cwd, 1);
+  free(cwd);
+  return 0;
+}
+
+// --------------------------- int builtin_pwd(char **argv) -----------------------
+// Purpose:
+// - "pwd" prints the current directory
+// --------------------------------------------------------------------------------
+int builtin_pwd(char **argv) {
+  (void)argv;
+  char *cwd = getcwd(NULL, 0);
+  if (cwd == NULL) {
+    fprintf(stderr, "osh: pwd: %s\n", strerror(errno));
+    return 1;
+  }
+  printf("%s\n", cwd);
+  free(cwd);
+  return 0;
+}
+
+// --------------------------- int builtin_echo(char **argv) ----------------------
+// Purpose:
+// - "echo [-n] args..." prints its arguments separated by spaces
+// --------------------------------------------------------------------------------
+int builtin_echo(char **argv) {
+  int i = 1;
+  bool newline = true;
+  if (argv[1] && equal(argv[1], "-n")) {
+    newline = false;
+    i++;
+  }
+  for (int first = i; argv[i] != NULL; i++) {
+    if (i > first) putchar(' ');
+    fputs(argv[i], stdout);
+  }
+  if (newline) putchar('\n');
+  return 0;
+}
+
+// ----------------------- int builtin_true / builtin_false -----------------------
+// Purpose:
+// - "true" and "false" only set the exit status
+// --------------------------------------------------------------------------------
+int builtin_true(char **argv) {
+  (void)argv;
+  return 0;
+}
+
+int builtin_false(char **argv) {
+  (void)argv;
+  return 1;
+}
+
+// -------------------------- int builtin_export(char **argv) ---------------------
+// Purpose:
+// - "export NAME=value..." sets environment variables for later commands
+// - "export" alone lists the environment
+// - Setting PATH drops the command hash table
+// --------------------------------------------------------------------------------
+int builtin_export(char **argv) {
+  if (argv[1] == NULL) {
+    for (char **env = environ; *env; env++) printf("export %s\n", *env);
+    return 0;
+  }
+
+  int status = 0;
+  for (int i = 1; argv[i] != NULL; i++) {
+    char *eq = strchr(argv[i], '=');
+    if (eq == NULL) continue; // every variable is already exported
+    *eq = '\0';
+    if (argv[i][0] == '\0' || setenv(argv[i], eq + 1, 1) == -1) {
+      fprintf(stderr, "osh: export: %s=%s: not a valid identifier\n", argv[i], eq + 1);
+      status = 1;
+    } else if (equal(argv[i], "PATH")) {
+      path_cache_clear();
+    }
+    *eq = '=';
+  }
+  return status;
+}
+
+// -------------------------- int builtin_unset(char **argv) ----------------------
+// Purpose:
+// - "unset NAME..." removes environment variables
+// --------------------------------------------------------------------------------
+int builtin_unset(char **argv) {
+  for (int i = 1; argv[i] != NULL; i++) {
+    unsetenv(argv[i]);
+    if (equal(argv[i], "PATH")) path_cache_clear();
+  }
+  return 0;
+}
+
+// --------------------------- int builtin_exit(char **argv) ----------------------
+// Purpose:
+// - "exit [n]" stops the shell after the current command with status n
+//   (default: the status of the previous command)
+// --------------------------------------------------------------------------------
+int builtin_exit(char **argv) {
+  exit_requested = true;
+  return argv[1] ? atoi(argv[1]) & 0xff : last_status;
+}
+
+// Builtin registry, checked before any command is spawned
+static Builtin builtins[] = {
+  {"ascii", builtin_ascii},
+  {"cd", builtin_cd},
+  {"echo", builtin_echo},
+  {"exit", builtin_exit},
+  {"export", builtin_export},
+  {"false", builtin_false},
+  {"fg", builtin_fg},
+  {"hash", builtin_hash},
+  {"jobs", builtin_jobs},
+  {"par", builtin_par},
+  {"pwd", builtin_pwd},
+  {"set", builtin_set},
+  {"stats", builtin_stats},
+  {"true", builtin_true},
+  {"unset", builtin_unset},
+  {"wait", builtin_wait},
+};
+
+// ------------------------- Builtin *find_builtin(char *name) --------------------
+// Purpose:
+// - Looks a command name up in the builtin registry
+// Returns:
+// - registry entry, or NULL if name is not a builtin
+// --------------------------------------------------------------------------------
+Builtin *find_builtin(char *name) {
+  for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+    if (equal(builtins[i].name, name)) return &builtins[i];
+  }
+  return NULL;
+}
+
+// ------------------------- int open_redirections(...) --------------------------
+// Purpose:
+// - Opens the files named by < and > in the parent, close-on-exec, so that a
+//   bad path is reported once by the shell instead of by a half-started child
+// - A file redirection overrides the pipe end the stage would otherwise use
+// Parameters:
+// - cmd - command whose redirections to open
+// - in_fd - in: fd the stage reads by default; out: fd it should read
+// - out_fd - in: fd the stage writes by default; out: fd it should write
+// Returns:
+// - 0 on success, -1 if a file could not be opened
 // ------------------------------------------------------------------------------
-void print_ascii_art() {
-  printf("  |\\_/|        ****************************    (\\_/)\n");
-  printf(" / @ @ \\       *  \"Purrrfectly pleasant\"  *   (='.'=)\n");
-  printf("( > º < )      *       Poppy Prinz        *   (\")_(\")\n");
-  printf(" `>>x<<´       *   (pprinz@example.com)   *\n");
-  printf(" /  O  \\       ****************************\n");
+static int open_redirections(Command *cmd, int *in_fd, int *out_fd) {
+  if (cmd->input_file) {
+    int fd = open(cmd->input_file, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+      fprintf(stderr, "osh: %s: %s\n", cmd->input_file, strerror(errno));
+      return -1;
+    }
+    *in_fd = fd;
+  }
+  if (cmd->output_file) {
+    int fd = open(cmd->output_file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+      fprintf(stderr, "osh: %s: %s\n", cmd->output_file, strerror(errno));
+      if (cmd->input_file) close(*in_fd);
+      return -1;
+    }
+    *out_fd = fd;
+  }
+  return 0;
 }
 
-// ---------- execute_single_command(char **tokens, bool background) ------------
+// ------------------------- static pid_t fork_stage(...) ------------------------
 // Purpose:
-// - Handles input/output redirection using dup2()
-// - Forks child process for command execution
-// - Parent waits for foreground commands
-// - Special handling for "ascii" command
+// - Starts a stage that needs code to run in the child before (or instead
+//   of) exec: builtins are fork()ed and run there, external commands with
+//   launch prefixes are vfork()ed, apply their limits and execve() at once
+// - Plain external commands go through posix_spawn instead
 // Parameters:
-// - tokens - array of command-line arguments
-// - background - boolean flag for background execution
+// - builtin - builtin to run, or NULL to execve path
+// - path - resolved program for external commands
+// - cmd - command to run
+// - in_fd - fd to install as stdin
+// - out_fd - fd to install as stdout
 // ------------------------------------------------------------------------------
-void execute_single_command(char **tokens, bool background) {
-  if (tokens[0] == NULL) return;
+static pid_t fork_stage(Builtin *builtin, char *path, Command *cmd, int in_fd, int out_fd) {
+  pid_t pid = builtin ? fork() : vfork();
+  if (pid == 0) {
+    sigprocmask(SIG_SETMASK, &shell_sigmask, NULL);
+    if (in_fd != STDIN_FILENO) dup2(in_fd, STDIN_FILENO);
+    if (out_fd != STDOUT_FILENO) dup2(out_fd, STDOUT_FILENO);
+    if (cmd->limits && apply_limits(cmd->limits) == -1) _exit(STATUS_CANNOT_RUN);
+    if (builtin == NULL) {
+      execve(path, cmd->argv, environ);
+      child_error(cmd->argv[0], errno);
+      _exit(STATUS_NOT_FOUND);
+    }
 
-  // Ascii art command handling
-  if (equal(tokens[0], "ascii") && tokens[1] == NULL) {
-    print_ascii_art();
-    return;
+    // A builtin never execs, so close-on-exec does not drop the shell's
+    // other pipe ends; close them or readers downstream never see EOF
+    close_range(3, ~0U, 0);
+    telemetry_fd = -1;
+    int status = builtin->fn(cmd->argv);
+    fflush(stdout);
+    _exit(status);
   }
+  if (pid < 0) perror("fork");
+  return pid;
+}
 
-  // Check for input/output redirection
-  char *input_file = NULL;
-  char *output_file = NULL;
-  int input_fd = -1, output_fd = -1;
+// ------------------ static int run_builtin(Builtin *, Command *) ---------------
+// Purpose:
+// - Runs a builtin inside the shell process; < and > are applied by saving
+//   stdin/stdout, dup2'ing the files over them and restoring afterwards
+// Parameters:
+// - builtin - builtin to run
+// - cmd - command with its redirections
+// Returns:
+// - exit status of the builtin
+// ------------------------------------------------------------------------------
+static int run_builtin(Builtin *builtin, Command *cmd) {
+  int in_fd = STDIN_FILENO, out_fd = STDOUT_FILENO;
+  if (open_redirections(cmd, &in_fd, &out_fd) == -1) return 1;
 
-  for (int i = 0; tokens[i] != NULL; i++) {
-    if (equal(tokens[i], "<")) {
-      input_file = tokens[i + 1];
-      tokens[i] = NULL;
-      break;
-    } else if (equal(tokens[i], ">")) {
-      output_file = tokens[i + 1];
-      tokens[i] = NULL;
-      break;
-    }
+  int saved_in = -1, saved_out = -1;
+  if (in_fd != STDIN_FILENO) {
+    saved_in = fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 10);
+    dup2(in_fd, STDIN_FILENO);
+    close(in_fd);
+  }
+  if (out_fd != STDOUT_FILENO) {
+    fflush(stdout); // earlier output belongs to the old stdout
+    saved_out = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 10);
+    dup2(out_fd, STDOUT_FILENO);
+    close(out_fd);
   }
 
-  // Check for background execution
-  pid_t pid = fork();
-  if (pid == 0) {
+  int status = builtin->fn(cmd->argv);
 
-    // Handle input/output redirection
-    if (input_file) {
-      input_fd = open(input_file, O_RDONLY);
-      if (input_fd == -1) {
-        perror("open");
-        exit(EXIT_FAILURE);
-      }
-      dup2(input_fd, STDIN_FILENO);
-      close(input_fd);
+  if (saved_out != -1) {
+    fflush(stdout);
+    dup2(saved_out, STDOUT_FILENO);
+    close(saved_out);
+  }
+  if (saved_in != -1) {
+    dup2(saved_in, STDIN_FILENO);
+    close(saved_in);
+  }
+  return status;
+}
+
+// --------------- pid_t spawn_stage(Command *cmd, int in, int out) -------------
+// Purpose:
+// - Starts one command with the given stdin/stdout; builtins are forked,
+//   commands with launch prefixes are vfork()ed, all others use a single
+//   posix_spawn (vfork-style clone + exec, no copy of the shell's memory)
+//   on the path remembered by the command hash table
+// - All shell-side pipe and file fds are close-on-exec, so the child only
+//   inherits what is dup2'ed onto 0 and 1
+// Parameters:
+// - cmd - command to run
+// - in_fd - fd to install as stdin (STDIN_FILENO to inherit)
+// - out_fd - fd to install as stdout (STDOUT_FILENO to inherit)
+// Returns:
+// - pid of the child, or -1 if it could not be started
+// ------------------------------------------------------------------------------
+pid_t spawn_stage(Command *cmd, int in_fd, int out_fd) {
+  int redirect_in = in_fd, redirect_out = out_fd;
+  if (open_redirections(cmd, &redirect_in, &redirect_out) == -1) return -1;
+
+  // Output of earlier builtins must reach stdout before the child's does
+  fflush(stdout);
+
+  pid_t pid;
+  Builtin *builtin = find_builtin(cmd->argv[0]);
+  if (builtin) {
+    pid = fork_stage(builtin, NULL, cmd, redirect_in, redirect_out);
+  } else if (cmd->limits) {
+    char *path = path_cache_lookup(cmd->argv[0]);
+    if (path) {
+      pid = fork_stage(NULL, path, cmd, redirect_in, redirect_out);
+    } else {
+      fprintf(stderr, "osh: %s: command not found\n", cmd->argv[0]);
+      pid = -1;
+    }
+  } else {
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (redirect_in != STDIN_FILENO) {
+      posix_spawn_file_actions_adddup2(&actions, redirect_in, STDIN_FILENO);
+    }
+    if (redirect_out != STDOUT_FILENO) {
+      posix_spawn_file_actions_adddup2(&actions, redirect_out, STDOUT_FILENO);
     }
+    // The caller holds SIGCHLD blocked; the child must not inherit that
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setsigmask(&attr, &shell_sigmask);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
 
-    if (output_file) {
-      output_fd = open(output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-      if (output_fd == -1) {
-        perror("open");
-        exit(EXIT_FAILURE);
+    // execve the cached path directly; if the file vanished since it was
+    // cached, forget it and resolve once more
+    int err = ENOENT;
+    char *path = path_cache_lookup(cmd->argv[0]);
+    if (path) {
+      err = posix_spawn(&pid, path, &actions, &attr, cmd->argv, environ);
+      if (err == ENOENT && path != cmd->argv[0]) {
+        path_cache_forget(cmd->argv[0]);
+        path = path_cache_lookup(cmd->argv[0]);
+        err = path ? posix_spawn(&pid, path, &actions, &attr, cmd->argv, environ) : ENOENT;
       }
-      dup2(output_fd, STDOUT_FILENO);
-      close(output_fd);
     }
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    if (err != 0) {
+      if (path == NULL) {
+        fprintf(stderr, "osh: %s: command not found\n", cmd->argv[0]);
+      } else {
+        fprintf(stderr, "osh: %s: %s\n", cmd->argv[0], strerror(err));
+      }
+      pid = -1;
+    }
+  }
+
+  // Only close what open_redirections() opened; pipe ends belong to the caller
+  if (redirect_in != in_fd) close(redirect_in);
+  if (redirect_out != out_fd) close(redirect_out);
+  return pid;
+}
 
-    // Execute commnad
-    execvp(tokens[0], tokens);
-    perror("execvp");
-    exit(EXIT_FAILURE);
-  } 
-  else if (pid > 0 && !background) {waitpid(pid, NULL, 0);}
-  else if (pid < 0) {perror("fork");}
+// ------------------------ static char *seg_text(Segment *seg) -----------------
+// Purpose:
+// - Copies a segment's text for its job when something will report it
+//   (background notices or telemetry); NULL otherwise
+// ------------------------------------------------------------------------------
+static char *seg_text(Segment *seg) {
+  return seg->background || opt_telemetry ? strdup(seg->text) : NULL;
 }
 
-// ------- execute_pipeline(char **left, char **right, bool background) --------
+// ----------------- int execute_single_command(Segment *seg) ------------------
 // Purpose:
-// - Creates pipe and connects commands via dup2
-// - Forks processes for both sides of pipe
-// - Manages file descriptor cleanup
+// - Runs foreground builtins in the shell itself, without forking
+// - Handles input/output redirection
+// - Spawns child process for other commands
+// - Parent waits for foreground commands, background ones join the job table
 // Parameters:
-// - left - array of tokens for left command (before pipe)
-// - right - array of tokens for right command (after pipe)
-// - background - boolean flag for background execution
+// - seg - segment with a single stage
+// Returns:
+// - exit status of the command (0 for background commands)
 // ------------------------------------------------------------------------------
-void execute_pipeline(char **left, char **right, bool background) {
-  int pipefd[2];
-  if (pipe(pipefd) == -1) {
-    perror("pipe");
-    return;
+int execute_single_command(Segment *seg) {
+  Command *cmd = &seg->stages[0];
+
+  // Builtins need no child unless they run in the background or have
+  // launch prefixes, which must not change the shell itself
+  Builtin *builtin = find_builtin(cmd->argv[0]);
+  if (builtin && !seg->background && cmd->limits == NULL) {
+    if (!seg->timed && !opt_telemetry) return run_builtin(builtin, cmd);
+
+    // Measure the builtin as a delta of the shell's own usage
+    JobUsage usage;
+    struct rusage before;
+    getrusage(RUSAGE_SELF, &before);
+    clock_gettime(CLOCK_MONOTONIC, &usage.started);
+    int status = run_builtin(builtin, cmd);
+    clock_gettime(CLOCK_MONOTONIC, &usage.finished);
+    getrusage(RUSAGE_SELF, &usage.rusage);
+    timersub(&usage.rusage.ru_utime, &before.ru_utime, &usage.rusage.ru_utime);
+    timersub(&usage.rusage.ru_stime, &before.ru_stime, &usage.rusage.ru_stime);
+    usage.rusage.ru_nvcsw -= before.ru_nvcsw;
+    usage.rusage.ru_nivcsw -= before.ru_nivcsw;
+    if (seg->timed) print_usage(&usage);
+    telemetry_record(seg->text, &usage, status);
+    return status;
   }
 
-  // Fork processes for left and right commands
+  // Register the child before SIGCHLD can report it
+  block_sigchld(true);
+  Job *job = job_create(1, seg_text(seg), seg->background);
+  job->timed = seg->timed;
+  pid_t pid = spawn_stage(cmd, STDIN_FILENO, STDOUT_FILENO);
+  job_set_pid(job, 0, pid);
+  int status = 0;
+  if (pid < 0) {
+    job_remove(job);
+    status = STATUS_NOT_FOUND;
+  } else if (seg->background) {
+    if (interactive) printf("[%d] %d\n", job->id, pid);
+  } else {
+    status = job_wait(job);
+  }
+  block_sigchld(false);
+  return status;
+}
 
-  // Fork process for left command
-  pid_t left_pid = fork();
-  if (left_pid == 0) {
-    close(pipefd[RD]);
-    dup2(pipefd[WR], STDOUT_FILENO);
-    close(pipefd[WR]);
-    execute_single_command(left, false);
-    exit(EXIT_SUCCESS);
+// -------------------------------- Pipeline tap ----------------------------------
+// With "set -o tap" a foreground pipeline gets a relay process between every
+// pair of stages instead of one pipe. The relay moves data with splice() (no
+// copy through user space) and measures how long it sat waiting for the
+// upstream stage to produce and for the downstream stage to consume; the
+// shell prints the totals when the pipeline finishes. $OSH_PIPE_SIZE resizes
+// every pipeline pipe with F_SETPIPE_SZ, tapped or not.
+// --------------------------------------------------------------------------------
+// ---------------------------- int open_pipe(int fds[2]) -------------------------
+// Purpose:
+// - Creates a close-on-exec pipe, sized from $OSH_PIPE_SIZE if set
+// Returns:
+// - 0 on success, -1 on failure
+// --------------------------------------------------------------------------------
+int open_pipe(int fds[2]) {
+  if (pipe2(fds, O_CLOEXEC) == -1) return -1;
+  char *size_var = getenv("OSH_PIPE_SIZE");
+  rlim_t size;
+  if (size_var && parse_size(size_var, &size) && size != RLIM_INFINITY) {
+    // Resizing the write end resizes the pipe; failure leaves the default
+    fcntl(fds[WR], F_SETPIPE_SZ, (int)size);
   }
-   
-  // Fork process for right command
-  pid_t right_pid = fork();
-  if (right_pid == 0) {
-    close(pipefd[WR]);
-    dup2(pipefd[RD], STDIN_FILENO);
-    close(pipefd[RD]);
-    execute_single_command(right, false);
-    exit(EXIT_SUCCESS);
+  return 0;
+}
+
+// -------------------------- static long long now_ns() ---------------------------
+// Purpose:
+// - CLOCK_MONOTONIC in nanoseconds
+// --------------------------------------------------------------------------------
+static long long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// ------------------- static void relay(int in, int out, TapStats *) -------------
+// Purpose:
+// - Moves everything from in to out with non-blocking splice() and, when
+//   it cannot make progress, waits in poll() on whichever side is stuck,
+//   charging the wait to that side
+// Parameters:
+// - in - read end of the upstream stage's pipe
+// - out - write end of the downstream stage's pipe
+// - stats - shared counters for this relay
+// --------------------------------------------------------------------------------
+static void relay(int in, int out, TapStats *stats) {
+  struct pollfd upstream = {in, POLLIN, 0};
+  struct pollfd downstream = {out, POLLOUT, 0};
+  long long start = now_ns();
+  while (true) {
+    ssize_t n = splice(in, NULL, out, NULL, TAP_CHUNK, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (n > 0) {
+      stats->bytes += n;
+      continue;
+    }
+    if (n == 0) break; // upstream closed and drained
+    if (errno == EINTR) continue;
+    if (errno != EAGAIN) break; // EPIPE: downstream is gone
+
+    // Nothing to read means upstream is slow, otherwise downstream is full
+    long long t0 = now_ns();
+    if (poll(&upstream, 1, 0) == 0) {
+      poll(&upstream, 1, -1);
+      stats->wait_upstream_ns += now_ns() - t0;
+    } else {
+      poll(&downstream, 1, -1);
+      stats->wait_downstream_ns += now_ns() - t0;
+    }
   }
+  stats->total_ns = now_ns() - start;
+}
 
-  // Cleanup
-  close(pipefd[RD]);
-  close(pipefd[WR]);
+// ------------------ static pid_t start_relay(int in, int out, ...) --------------
+// Purpose:
+// - Forks a relay process between two stages; it keeps only its two pipe
+//   ends so that EOF and EPIPE still reach the stages
+// --------------------------------------------------------------------------------
+static pid_t start_relay(int in, int out, TapStats *stats) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    sigprocmask(SIG_SETMASK, &shell_sigmask, NULL);
+    signal(SIGPIPE, SIG_IGN); // a closed downstream shows up as EPIPE
+    dup2(in, STDIN_FILENO);
+    dup2(out, STDOUT_FILENO);
+    close_range(3, ~0U, 0);
+    relay(STDIN_FILENO, STDOUT_FILENO, stats);
+    _exit(0);
+  }
+  if (pid < 0) perror("fork");
+  return pid;
+}
 
-  if (!background) {
-    waitpid(left_pid, NULL, 0);
-    waitpid(right_pid, NULL, 0);
+// -------------------- static void tap_report(Segment *, TapStats *) -------------
+// Purpose:
+// - Prints bytes, throughput and wait split for every stage boundary
+// --------------------------------------------------------------------------------
+static void tap_report(Segment *seg, TapStats *stats) {
+  for (int s = 0; s < seg->num_stages - 1; s++) {
+    TapStats *st = &stats[s];
+    double secs = st->total_ns / 1e9;
+    double mbps = secs > 0 ? st->bytes / secs / (1 << 20) : 0;
+    fprintf(stderr, "tap: %d %s -> %d %s: %lld bytes in %.3f s (%.1f MB/s), "
+            "waited %.3f s on %s, %.3f s on %s\n",
+            s + 1, seg->stages[s].argv[0], s + 2, seg->stages[s + 1].argv[0],
+            st->bytes, secs, mbps,
+            st->wait_upstream_ns / 1e9, seg->stages[s].argv[0],
+            st->wait_downstream_ns / 1e9, seg->stages[s + 1].argv[0]);
   }
 }
 
-// ---------------------------- processLine(char *line) -------------------------
+// -------------------- int execute_pipeline(Segment *seg) ---------------------
 // Purpose:
-// - Parses input line into segments based on separators (;, &, |)
-// - Handles background execution and command piping
+// - Starts one child per stage of a | b | ... | z
+// - Connects neighbouring stages with close-on-exec pipes so each child
+//   only sees its own two ends
+// - Waits for every stage of a foreground pipeline, background pipelines
+//   join the job table
 // Parameters:
-// - line - input line to be processed
+// - seg - segment with two or more stages
+// Returns:
+// - exit status of the last stage (0 for background pipelines)
 // ------------------------------------------------------------------------------
-void processLine(char *line) {
-  char *tokens[MAX_TOKENS];
-  int token_count = 0;
+int execute_pipeline(Segment *seg) {
+  int num_stages = seg->num_stages;
 
-  // Tokenize the input line
-  char *token = strtok(line, " \t");
-  while (token != NULL && token_count < MAX_TOKENS - 1) {
-    tokens[token_count++] = token;
-    token = strtok(NULL, " \t");
+  // Tapped pipelines get one relay per boundary; relays take the first job
+  // slots so the last stage stays last and decides the status
+  bool tap = opt_tap && !seg->background;
+  int num_relays = tap ? num_stages - 1 : 0;
+  TapStats *stats = NULL;
+  if (tap) {
+    stats = mmap(NULL, num_relays * sizeof(TapStats), PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (stats == MAP_FAILED) {
+      perror("mmap");
+      stats = NULL;
+      tap = false;
+      num_relays = 0;
+    }
   }
-  tokens[token_count] = NULL;
 
-  // Segment structure to hold command segments
-  struct {
-    char **tokens;
-    bool background;
-  } segments[MAX_SEGMENTS];
-  int num_segments = 0;
+  // Start every stage; prev_read is the read end feeding the current stage
+  block_sigchld(true);
+  Job *job = job_create(num_relays + num_stages, seg_text(seg), seg->background);
+  job->timed = seg->timed;
+  int prev_read = STDIN_FILENO;
+  for (int s = 0; s < num_stages; s++) {
+    int pipefd[2] = {-1, STDOUT_FILENO};
+    if (s < num_stages - 1 && open_pipe(pipefd) == -1) {
+      perror("pipe");
+      pipefd[WR] = -1;
+    }
+    pid_t pid = pipefd[WR] == -1 ? -1 : spawn_stage(&seg->stages[s], prev_read, pipefd[WR]);
+    job_set_pid(job, num_relays + s, pid);
 
-  int i = 0;
-  while (i < token_count) {
-    int start = i;
+    // The parent keeps neither end once the children hold them
+    if (prev_read != STDIN_FILENO) close(prev_read);
+    if (pipefd[WR] != STDOUT_FILENO && pipefd[WR] != -1) close(pipefd[WR]);
+    prev_read = pipefd[RD];
 
-    // Find the end of the current segment
-    while (i < token_count && !equal(tokens[i], ";") && !equal(tokens[i], "&")) {
-      i++;
+    // Splice the stage's output through a relay into a second pipe
+    if (tap && prev_read != -1) {
+      int tapfd[2];
+      if (open_pipe(tapfd) == -1) {
+        perror("pipe");
+        close(prev_read);
+        prev_read = -1;
+      } else {
+        job_set_pid(job, s, start_relay(prev_read, tapfd[WR], &stats[s]));
+        close(prev_read);
+        close(tapfd[WR]);
+        prev_read = tapfd[RD];
+      }
+    }
+    if (prev_read == -1) {
+      // pipe() failed: do not start the rest of the chain
+      job_set_pid(job, num_relays + num_stages - 1, -1);
+      break;
     }
+  }
 
-    bool background = false;
-    int end = i;
+  // Wait for all stages; the pipeline's status is that of the last one
+  int status = 0;
+  if (seg->background) {
+    if (interactive) printf("[%d] %d\n", job->id, job->pids[num_stages - 1]);
+  } else {
+    status = job_wait(job);
+  }
+  block_sigchld(false);
+  if (stats) {
+    tap_report(seg, stats);
+    munmap(stats, num_relays * sizeof(TapStats));
+  }
+  return status;
+}
+
+// ------------------------------ Parallel fan-out --------------------------------
+// "par [-j N] [-k] cmd args..." runs cmd once per line of stdin with at most N
+// children at a time. Each {} in the arguments is replaced by the line (the
+// line is appended if there is no {}). A slot is reused as soon as its child
+// is reaped. With -k every child writes to its own memfd and outputs are
+// copied to stdout in input order; otherwise children share stdout.
+// --------------------------------------------------------------------------------
+
+// ------------------- static char **par_expand(char **, char *) -----------------
+// Purpose:
+// - Builds the argv for one input line from the command template
+// Returns:
+// - malloc'ed argv; entries that differ from the template are malloc'ed too
+// --------------------------------------------------------------------------------
+static char **par_expand(char **template, char *line) {
+  int n = 0;
+  bool has_placeholder = false;
+  for (; template[n] != NULL; n++) {
+    if (strstr(template[n], "{}")) has_placeholder = true;
+  }
 
-    // Check if a separator was found
-    if (i < token_count) {
-      background = equal(tokens[i], "&");
-      i++;
+  char **args = malloc((n + 2) * sizeof(char *));
+  size_t line_len = strlen(line);
+  for (int i = 0; i < n; i++) {
+    char *arg = template[i];
+    char *hole = strstr(arg, "{}");
+    if (hole == NULL) {
+      args[i] = arg;
+      continue;
+    }
+    int holes = 0;
+    for (char *h = hole; h; h = strstr(h + 2, "{}")) holes++;
+    char *out = malloc(strlen(arg) + holes * line_len + 1);
+    char *p = out;
+    while (hole) {
+      memcpy(p, arg, hole - arg);
+      p += hole - arg;
+      memcpy(p, line, line_len);
+      p += line_len;
+      arg = hole + 2;
+      hole = strstr(arg, "{}");
     }
+    strcpy(p, arg);
+    args[i] = out;
+  }
+  if (!has_placeholder) args[n++] = line;
+  args[n] = NULL;
+  return args;
+}
 
-    // Extract tokens for this segment
-    int seg_len = end - start;
-    char **seg_tokens = malloc((seg_len + 1) * sizeof(char *));
-    for (int j = 0; j < seg_len; j++) {
-      seg_tokens[j] = tokens[start + j];
+// --------------------- static void copy_to_stdout(int fd) ----------------------
+// Purpose:
+// - Copies a finished -k job's output file to stdout in the kernel
+// --------------------------------------------------------------------------------
+static void copy_to_stdout(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) == -1) return;
+  off_t offset = 0;
+  while (offset < st.st_size) {
+    ssize_t n = sendfile(STDOUT_FILENO, fd, &offset, st.st_size - offset);
+    if (n > 0) continue;
+    if (n == -1 && errno == EINTR) continue;
+
+    // sendfile() refused this stdout; fall back to read/write
+    char buf[8192];
+    while ((n = pread(fd, buf, sizeof(buf), offset)) > 0) {
+      if (write(STDOUT_FILENO, buf, n) != n) return;
+      offset += n;
     }
-    seg_tokens[seg_len] = NULL;
+    return;
+  }
+}
 
-     // Store the segment
-    segments[num_segments].tokens = seg_tokens;
-    segments[num_segments].background = background;
-    num_segments++;
+// ------------------------------ int builtin_par(char **argv) --------------------
+// Purpose:
+// - "par [-j N] [-k] cmd args..." fans cmd out over the lines of stdin
+// - Reports every job that fails on stderr with its exit status
+// Returns:
+// - number of failed jobs (at most 101), 2 on a usage error
+// --------------------------------------------------------------------------------
+int builtin_par(char **argv) {
+  int max_jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  bool keep_order = false;
+  int i = 1;
+  for (; argv[i] && argv[i][0] == '-'; i++) {
+    if (equal(argv[i], "-k")) {
+      keep_order = true;
+    } else if (equal(argv[i], "-j") && argv[i + 1]) {
+      max_jobs = atoi(argv[++i]);
+    } else if (strncmp(argv[i], "-j", 2) == 0 && argv[i][2]) {
+      max_jobs = atoi(argv[i] + 2);
+    } else {
+      break;
+    }
+  }
+  char **template = &argv[i];
+  if (template[0] == NULL) {
+    fprintf(stderr, "usage: par [-j N] [-k] command [args with {}...] < list\n");
+    return 2;
   }
+  if (max_jobs < 1) max_jobs = 1;
 
-  // Execute each segment
-  for (int s = 0; s < num_segments; s++) {
-    char **tokens = segments[s].tokens;
-    bool background = segments[s].background;
+  // Children must not compete with us for the list on stdin
+  int devnull = open("/dev/null", O_RDONLY | O_CLOEXEC);
+  ParJob *slots = calloc(max_jobs, sizeof(ParJob));
+  int *outputs = NULL; // -k: output fd per sequence number, -1 while running
+  int outputs_cap = 0, next_print = 0;
+  int running = 0, seq = 0, failed = 0;
+
+  LineReader reader;
+  line_reader_init(&reader, STDIN_FILENO);
+  block_sigchld(true);
+  while (true) {
+    // Reap finished children until a slot is free (all slots at end of input)
+    char *line = NULL;
+    while (true) {
+      for (int s = 0; s < max_jobs; s++) {
+        ParJob *slot = &slots[s];
+        if (slot->job == NULL || slot->job->alive > 0) continue;
+        if (slot->job->status != 0) {
+          fprintf(stderr, "par: %s: exit %d\n", slot->job->text, slot->job->status);
+          failed++;
+        }
+        if (keep_order) outputs[slot->seq] = slot->out_fd; // STDOUT_FILENO: no memfd
+        job_remove(slot->job);
+        slot->job = NULL;
+        running--;
+      }
+      while (keep_order && next_print < seq && outputs[next_print] >= 0) {
+        int fd = outputs[next_print++];
+        if (fd == STDOUT_FILENO) continue;
+        copy_to_stdout(fd);
+        close(fd);
+      }
+      if (running < max_jobs && line == NULL && !reader.eof) {
+        line = line_reader_next(&reader);
+        if (line && line[0] == '\0') { // skip blank lines
+          line = NULL;
+          continue;
+        }
+      }
+      if (running == 0 && line == NULL) break;
+      if (running < max_jobs && line != NULL) break;
+      sigsuspend(&shell_sigmask);
+    }
+    if (line == NULL) break;
 
-    int pipe_pos = -1;
-    for (int i = 0; tokens[i] != NULL; i++) {
-      if (equal(tokens[i], "|")) {
-        pipe_pos = i;
-        break;
+    int s = 0;
+    while (slots[s].job != NULL) s++;
+    ParJob *slot = &slots[s];
+    slot->seq = seq++;
+    slot->out_fd = STDOUT_FILENO;
+    if (keep_order) {
+      slot->out_fd = memfd_create("par", MFD_CLOEXEC);
+      if (slot->out_fd == -1) slot->out_fd = STDOUT_FILENO;
+      if (seq > outputs_cap) {
+        outputs_cap = outputs_cap ? outputs_cap * 2 : 64;
+        outputs = realloc(outputs, outputs_cap * sizeof(int));
       }
+      outputs[slot->seq] = -1;
+    }
+
+    char **args = par_expand(template, line);
+    Command cmd = {args, NULL, NULL, NULL, NULL, NULL, NULL};
+    slot->job = job_create(1, strdup(line), false);
+    job_set_pid(slot->job, 0, spawn_stage(&cmd, devnull, slot->out_fd));
+    running++;
+    for (int a = 0; args[a] != NULL; a++) {
+      if (args[a] != line && args[a] != template[a]) free(args[a]);
     }
-    // If a pipe is found, split the command into left and right segments
-    if (pipe_pos != -1) {
-      char **left = tokens;
-      left[pipe_pos] = NULL;
-      char **right = &tokens[pipe_pos + 1];
-      execute_pipeline(left, right, background);
+    free(args);
+  }
+  block_sigchld(false);
+
+  line_reader_free(&reader);
+  free(outputs);
+  free(slots);
+  close(devnull);
+  return failed > 101 ? 101 : failed;
+}
+
+// ---------------------------- processLine(char *line) -------------------------
+// Purpose:
+// - Parses input line into segments based on separators (;, &, |)
+// - Handles background execution and command piping
+// - Rewinds the line arena first, so the previous line's tokens are reused
+// Parameters:
+// - line - input line to be processed (not modified)
+// ------------------------------------------------------------------------------
+void processLine(char *line) {
+  arena_reset(&line_arena);
+
+  int num_segments;
+  Segment *segments = parse(line, &num_segments);
+  if (segments == NULL) {
+    last_status = 2;
+    return;
+  }
+
+  // Execute each segment; any number of | turns it into a pipeline
+  for (int s = 0; s < num_segments && !exit_requested; s++) {
+    if (!glob_segment(&segments[s])) {
+      last_status = 1;
+    } else if (segments[s].num_stages > 1) {
+      last_status = execute_pipeline(&segments[s]);
     } else {
-      execute_single_command(tokens, background);
+      last_status = execute_single_command(&segments[s]);
     }
-    free(tokens);
   }
 }
 
@@ -255,17 +2492,19 @@ void processLine(char *line) {
 // ------------------------------------------------------------------------------
 int interactiveShell() {
   bool should_run = true;
-  char *line = calloc(1, MAXLINE);
+  char *line = NULL;
   static char *last_command = NULL;
  
   // Prompt for user input
+  interactive = true;
   while (should_run) { 
+    job_notify(true);
     printf(PROMPT);
     fflush(stdout);
     int n = fetchline(&line);
 
-    // Check for exit command
-    if (n == -1 || equal(line, "exit")) {
+    // Check for end of input
+    if (n == -1) {
       should_run = false;
       continue;
     }
@@ -280,37 +2519,228 @@ int interactiveShell() {
         printf("No commands in history.\n");
         continue;
       }
-      strncpy(line, last_command, MAXLINE);
-      line[MAXLINE - 1] = '\0';
-      printf("osh> %s\n", line);
+      printf("osh> %s\n", last_command);
     } 
     else {
       free(last_command);
       last_command = strdup(line);
     }
 
-    processLine(line);
+    processLine(last_command);
+    if (exit_requested) should_run = false;
   }
   // Free allocated memory
   free(line);
   free(last_command);
-  return 0;
+  return last_status;
+}
+
+// ---------------------------- int runCommand(char *command) ------------------
+// Purpose:
+// - Runs one command line given with -c, without prompting
+// Parameters:
+// - command - the command line
+// Returns:
+// - exit status of the last command
+// ------------------------------------------------------------------------------
+int runCommand(char *command) {
+  processLine(command);
+  return last_status;
 }
 
-// ---------------------------- int runTests() ---------------------------------
+// ----------------------------- int runScript(char *path) ----------------------
 // Purpose:
-// - Runs built-in test cases for the shell
-// - Tests various command scenarios
+// - Runs a script file line by line, without prompts or per-line fflush
+// - Streams the file through a LineReader, so lines are handed to
+//   processLine() in place with no per-line read() or copy
+// Parameters:
+// - path - script to run
+// Returns:
+// - exit status of the last command, or 127 if the file cannot be opened
 // ------------------------------------------------------------------------------
-int runTests() {
-  printf("*** Running basic tests ***\n");
+int runScript(char *path) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    fprintf(stderr, "osh: %s: %s\n", path, strerror(errno));
+    return STATUS_NOT_FOUND;
+  }
+
+  LineReader reader;
+  line_reader_init(&reader, fd);
+  char *line;
+  while (!exit_requested && (line = line_reader_next(&reader)) != NULL) {
+    processLine(line);
+    job_notify(false);
+  }
+  line_reader_free(&reader);
+  close(fd);
+  return last_status;
+}
+
+// -------------------------------- Benchmark suite -------------------------------
+// "osh --bench [N]" measures the execution paths the shell depends on and
+// prints one JSON object per benchmark (samples, mean, min, p50, p90, p99,
+// max), so runs can be diffed to catch regressions:
+// - builtin_lookup: registry lookup alone (ns)
+// - builtin_line: a whole "true" line, lexed, parsed and dispatched (us)
+// - command_line: a whole trivial external command line (us)
+// - fork_exec / vfork_exec / posix_spawn: raw start + reap of true (us)
+// - pipe_2 / pipe_4 / pipe_8: MB/s through an N-stage cat pipeline
+// --------------------------------------------------------------------------------
+
+// ------------------------ static int compare_doubles(...) -----------------------
+// Purpose:
+// - qsort comparator for ascending doubles
+// --------------------------------------------------------------------------------
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+// -------------------- static double percentile(double *, int, double) -----------
+// Purpose:
+// - Nearest-rank percentile of sorted samples
+// --------------------------------------------------------------------------------
+static double percentile(double *sorted, int n, double p) {
+  int rank = (int)(p * n + 0.999999);
+  if (rank < 1) rank = 1;
+  return sorted[rank - 1];
+}
 
-  // Test cases for the shell
-  char lines[7][MAXLINE] = {"ls", "ls -al", "ls & whoami ;", "ls > junk.txt", "cat < junk.txt", "ls | wc", "ascii"};
-  for (int i = 0; i < 7; i++) {
-    printf("* %d. Testing %s *\n", i + 1, lines[i]);
-    processLine(lines[i]);
+// --------------- static void bench_report(char *, char *, double *, int) --------
+// Purpose:
+// - Sorts the samples and prints one benchmark as a JSON line; latency
+//   benchmarks also get the implied rate per second
+// --------------------------------------------------------------------------------
+static void bench_report(char *name, char *unit, double *samples, int n) {
+  qsort(samples, n, sizeof(double), compare_doubles);
+  double sum = 0;
+  for (int i = 0; i < n; i++) sum += samples[i];
+  double mean = sum / n;
+  printf("{\"bench\":\"%s\",\"unit\":\"%s\",\"n\":%d,\"mean\":%.3f,\"min\":%.3f,"
+         "\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f",
+         name, unit, n, mean, samples[0], percentile(samples, n, 0.50),
+         percentile(samples, n, 0.90), percentile(samples, n, 0.99), samples[n - 1]);
+  if (equal(unit, "us") && mean > 0) printf(",\"per_sec\":%.1f", 1e6 / mean);
+  if (equal(unit, "ns") && mean > 0) printf(",\"per_sec\":%.1f", 1e9 / mean);
+  printf("}\n");
+  fflush(stdout);
+}
+
+// ------------------ static void bench_line(char *, char *, double *, int) -------
+// Purpose:
+// - Times n runs of a command line through processLine()
+// --------------------------------------------------------------------------------
+static void bench_line(char *name, char *line, double *samples, int n) {
+  for (int i = 0; i < n; i++) {
+    long long t0 = now_ns();
+    processLine(line);
+    samples[i] = (now_ns() - t0) / 1e3;
+  }
+  bench_report(name, "us", samples, n);
+}
+
+// ------------------------ static pid_t bench_launch(int, char *) ---------------
+// Purpose:
+// - Starts path with one launch method. Kept out of bench_spawn's loop so no
+//   loop state is live across vfork()
+// Parameters:
+// - method - 0 fork+execve, 1 vfork+execve, 2 posix_spawn
+// Returns:
+// - the child's pid, or -1 if it could not be started
+// --------------------------------------------------------------------------------
+static pid_t bench_launch(int method, char *path) {
+  char *argv[] = {path, NULL};
+  pid_t pid;
+  if (method == 2) {
+    if (posix_spawn(&pid, path, NULL, NULL, argv, environ) != 0) pid = -1;
+    return pid;
+  }
+  pid = method == 0 ? fork() : vfork();
+  if (pid == 0) {
+    execve(path, argv, environ);
+    _exit(STATUS_NOT_FOUND);
+  }
+  return pid;
+}
+
+// --------------- static void bench_spawn(char *, int, char *, double *, int) ----
+// Purpose:
+// - Times n raw starts and reaps of path with one launch method, bypassing
+//   the job table (SIGCHLD stays blocked, the child is reaped by pid)
+// Parameters:
+// - method - 0 fork+execve, 1 vfork+execve, 2 posix_spawn
+// --------------------------------------------------------------------------------
+static void bench_spawn(char *name, int method, char *path, double *samples, int n) {
+  block_sigchld(true);
+  for (int i = 0; i < n; i++) {
+    long long t0 = now_ns();
+    pid_t pid = bench_launch(method, path);
+    if (pid > 0) waitpid(pid, NULL, 0);
+    samples[i] = (now_ns() - t0) / 1e3;
+  }
+  block_sigchld(false);
+  bench_report(name, "us", samples, n);
+}
+
+// ------------------------------ int runBench(int n) -----------------------------
+// Purpose:
+// - Runs the benchmark suite with n samples per latency benchmark
+// Returns:
+// - 0, or 1 if "true" cannot be found for the spawn benchmarks
+// --------------------------------------------------------------------------------
+int runBench(int n) {
+  if (n < 1) n = BENCH_SAMPLES;
+  // The pipe benchmarks reuse the buffer for BENCH_PIPE_RUNS samples
+  double *samples = malloc((n > BENCH_PIPE_RUNS ? n : BENCH_PIPE_RUNS) * sizeof(double));
+
+  // Registry lookup alone: every builtin name plus one miss
+  size_t num_builtins = sizeof(builtins) / sizeof(builtins[0]);
+  for (int i = 0; i < n; i++) {
+    long long t0 = now_ns();
+    for (size_t b = 0; b < num_builtins; b++) find_builtin(builtins[b].name);
+    find_builtin("ls");
+    samples[i] = (double)(now_ns() - t0) / (num_builtins + 1);
+  }
+  bench_report("builtin_lookup", "ns", samples, n);
+
+  bench_line("builtin_line", "true", samples, n);
+  bench_line("command_line", "cat /dev/null", samples, n);
+
+  char *true_path = path_cache_lookup("true");
+  if (true_path == NULL) {
+    fprintf(stderr, "osh: bench: true: command not found\n");
+    free(samples);
+    return 1;
+  }
+  true_path = strdup(true_path);
+  bench_spawn("fork_exec", 0, true_path, samples, n);
+  bench_spawn("vfork_exec", 1, true_path, samples, n);
+  bench_spawn("posix_spawn", 2, true_path, samples, n);
+  free(true_path);
+
+  // Throughput: head feeding cats, the last one writing to /dev/null
+  int stage_counts[] = {2, 4, 8};
+  for (int c = 0; c < 3; c++) {
+    char line[256];
+    int len = snprintf(line, sizeof(line), "head -c %d /dev/zero", BENCH_PIPE_BYTES);
+    for (int s = 1; s < stage_counts[c]; s++) {
+      len += snprintf(line + len, sizeof(line) - len, " | cat");
+    }
+    snprintf(line + len, sizeof(line) - len, " > /dev/null");
+
+    for (int r = 0; r < BENCH_PIPE_RUNS; r++) {
+      long long t0 = now_ns();
+      processLine(line);
+      double secs = (now_ns() - t0) / 1e9;
+      samples[r] = BENCH_PIPE_BYTES / secs / (1 << 20);
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "pipe_%d", stage_counts[c]);
+    bench_report(name, "MB/s", samples, BENCH_PIPE_RUNS);
   }
+
+  free(samples);
   return 0;
 }
 
@@ -325,14 +2755,15 @@ bool equal(char *a, char *b) { return strcmp(a, b) == 0; }
 
 // -------------------------- int fetchline(char **line) ------------------------
 // Purpose:
-// - Reads a line from stdin
+// - Reads a line of any length from stdin, reusing the buffer
 // Parameters:
-// - line - pointer to the line buffer
+// - line - pointer to the line buffer (grown by getline as needed)
 // ------------------------------------------------------------------------------
 int fetchline(char **line) {
-  size_t len = 0;
-  ssize_t n = getline(line, &len, stdin);
-  if (n > 0) {
+  static size_t capacity = 0;
+  if (*line == NULL) capacity = 0;
+  ssize_t n = getline(line, &capacity, stdin);
+  if (n > 0 && (*line)[n - 1] == '\n') {
     (*line)[n - 1] = '\0';
   }
   return n;
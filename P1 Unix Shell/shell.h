@@ -8,10 +8,16 @@
 // This header file defines the interface for a UNIX-like shell implementation.
 // It provides constants, data structures, and function prototypes to support:
 // - Interactive command execution with background processes (&)
+// - Non-interactive execution of -c strings and script files
 // - Input/output redirection (< and >)
 // - Command piping (|)
 // - Command history (!!)
-// - Built-in test cases
+// - Builtins (cd, pwd, echo, export, exit, jobs, ...) without forking
+// - time prefix and opt-in per-command telemetry
+// - @cpu=, @nice= and resource-limit launch prefixes
+// - Per-stage pipeline throughput tap (set -o tap)
+// - Wildcard expansion (* ? [...]) over a cached directory listing
+// - Spawn-latency and pipe-throughput benchmark suite
 // - ASCII art
 // - Error handling for invalid commands
 // ---------------------------------------------------------------------------------
@@ -19,32 +25,271 @@
 #ifndef SHELL_H
 #define SHELL_H
 
+#define _GNU_SOURCE // pipe2, sched_setaffinity
+
 #include <assert.h>  // assert
+#include <dirent.h>  // DT_DIR
+#include <fnmatch.h> // fnmatch
+#include <sched.h>   // sched_setaffinity, cpu_set_t
+#include <errno.h>   // errno
 #include <fcntl.h>   // O_RDWR, O_CREAT
+#include <limits.h>  // PATH_MAX
+#include <spawn.h>   // posix_spawnp
 #include <stdbool.h> // bool
+#include <stdint.h>  // uint64_t
 #include <stdio.h>   // printf, getline
 #include <stdlib.h>  // calloc
-#include <string.h>  // strcmp
-#include <unistd.h>  // execvp
-#include <sys/wait.h>
+#include <string.h>  // strcmp, strerror
+#include <signal.h>  // sigaction, sigsuspend
+#include <unistd.h>  // execvp, pipe2
+#include <poll.h>    // poll
+#include <sys/mman.h> // memfd_create, mmap
+#include <sys/sendfile.h> // sendfile
+#include <sys/resource.h> // struct rusage
+#include <sys/stat.h> // stat
+#include <sys/syscall.h> // SYS_getdents64
+#include <sys/time.h> // timeradd
+#include <sys/wait.h> // wait4
+#include <time.h>     // clock_gettime
 
 // Config constants
-#define MAXLINE 80  // max length of input line
 #define PROMPT "osh> " // shell prompt
-#define MAX_TOKENS 40 // max number of tokens
-#define MAX_SEGMENTS 10 // max number of segments
+#define ARENA_BLOCK 4096 // first block of the per-line arena
+#define SCRIPT_BUFFER (1 << 16) // read size for script files
+#define TELEMETRY_LOG "osh-telemetry.log" // default for $OSH_TELEMETRY_LOG
+#define STATS_BUCKETS 32 // log2 latency buckets, 1 us .. ~35 min
+#define TAP_CHUNK (1 << 16) // most bytes one tap relay splice() moves
+#define BENCH_SAMPLES 1000 // default samples per latency benchmark
+#define BENCH_PIPE_BYTES (64 << 20) // bytes pushed through each pipeline run
+#define BENCH_PIPE_RUNS 5 // runs per pipeline benchmark
+#define HASH_BUCKETS 64 // buckets in the command hash table
+#define DIR_CACHE_SLOTS 16 // directories whose listing is kept for globbing
+#define DIR_READ_BUFFER (1 << 16) // bytes per getdents64() call
+#define DIR_RACY_NS 10000000LL // listings this close to the mtime are re-read
 
 // Pipe constants
 #define RD 0 // read end of pipe
 #define WR 1 // write end of pipe
 
+// Exit status reported when a command cannot be started
+#define STATUS_NOT_FOUND 127
+#define STATUS_CANNOT_RUN 126 // found, but its launch settings failed
+
+// Most @rlimit prefixes one command can carry
+#define MAX_RLIMITS 8
+
+// Launch settings from @cpu=, @nice= and @<rlimit>= prefixes
+typedef struct limits {
+  bool has_affinity; // @cpu= given
+  cpu_set_t cpus;    // CPUs the child may run on
+  bool has_nice;     // @nice= given
+  int nice;          // nice value for the child
+  int num_rlimits;   // entries used in rlimits
+  struct {
+    int resource;        // RLIMIT_*
+    struct rlimit limit; // soft and hard limit
+  } rlimits[MAX_RLIMITS];
+} Limits;
+
+// One stage of a pipeline after redirections have been stripped out
+typedef struct command {
+  char **argv;       // NULL-terminated argument vector
+  char *input_file;  // file named by <, or NULL
+  char *output_file; // file named by >, or NULL
+  Limits *limits;    // launch prefixes, or NULL
+  char **patterns;   // glob pattern of each argv word (NULL for plain
+                     // words), or NULL if the stage has none
+  char *input_pattern;  // glob pattern of input_file, or NULL
+  char *output_pattern; // glob pattern of output_file, or NULL
+} Command;
+
+// Segment of a line: a command or pipeline ended by ; or &
+typedef struct segment {
+  Command *stages; // one entry per pipeline stage
+  int num_stages;  // 1 for a plain command
+  bool background; // ended with &
+  bool timed;      // prefixed with "time"
+  char *text;      // source text, for job notices
+} Segment;
+
+// Lexer output
+typedef enum { TOK_WORD, TOK_PIPE, TOK_AMP, TOK_SEMI, TOK_LESS, TOK_GREAT } TokenType;
+typedef struct token {
+  TokenType type;
+  char *text;     // unquoted word, NULL for operators
+  char *pattern;  // text with quoted * ? [ ] \ escaped; NULL unless the
+                  // word has an unquoted * ? or [
+  int start, end; // byte range in the source line
+} Token;
+
+// Bump allocator for everything derived from one input line
+typedef struct arena_block {
+  struct arena_block *next;
+  size_t size; // usable bytes in data
+  size_t used; // bytes handed out since the last reset
+  char data[];
+} ArenaBlock;
+typedef struct arena {
+  ArenaBlock *head;    // first block, never freed
+  ArenaBlock *current; // block allocations come from
+} Arena;
+
+// Builtin registry entry
+typedef struct builtin {
+  char *name;               // command name
+  int (*fn)(char **argv);   // returns the exit status
+} Builtin;
+
+// Buffered line source over a raw fd (scripts, par input)
+typedef struct line_reader {
+  int fd;          // fd lines are read from
+  char *buffer;    // holds the current line and read-ahead
+  size_t capacity; // size of buffer, excluding the spare NUL byte
+  size_t start;    // offset of the first unreturned byte
+  size_t len;      // bytes valid in buffer
+  bool eof;        // fd reached end of input
+} LineReader;
+
+// Command hash table entry: name -> resolved absolute path
+typedef struct hash_entry {
+  char *name;              // command name as typed
+  char *path;              // absolute path it resolved to
+  int hits;                // times the entry was used
+  struct hash_entry *next; // next entry in the same bucket
+} HashEntry;
+
+// Resources used by one job, from wait4() on each of its stages
+typedef struct job_usage {
+  struct timespec started;  // CLOCK_MONOTONIC when the job was created
+  struct timespec finished; // CLOCK_MONOTONIC when its last stage was reaped
+  struct rusage rusage;     // summed over stages; ru_maxrss is the largest
+} JobUsage;
+
+// Record returned by getdents64(), as laid out by the kernel
+typedef struct dirent64_record {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+} Dirent64;
+
+// Cached listing of one directory, sorted by name
+typedef struct dir_cache {
+  char *path;              // directory as named in the pattern, NULL if free
+  dev_t dev;               // identity and mtime when it was read; a
+  ino_t ino;               // change to any of them forces a rescan
+  struct timespec mtime;
+  bool racy;               // read too soon after mtime to trust it
+  char *names;             // type byte + name + NUL, back to back
+  char **entries;          // sorted pointers into names
+  int count;               // number of entries; entries[i][-1] is its d_type
+  int pins;                // glob levels currently iterating this listing
+  unsigned long last_used; // lookup tick, for LRU eviction
+} DirCache;
+
+// Job table entry: one command or pipeline started by the shell
+typedef struct job {
+  int id;          // job number, used as %id
+  char *text;      // command line shown by jobs and notices
+  pid_t *pids;     // one pid per stage, 0 once reaped
+  int num_pids;    // number of stages
+  int alive;       // stages not yet reaped
+  int status;      // exit status of the last stage
+  bool background; // started with &
+  bool timed;      // print a "time" report when it finishes
+  JobUsage usage;  // filled in by the SIGCHLD handler
+} Job;
+
+// Latency histogram of one command name, for "stats"
+typedef struct command_stats {
+  char *name;                       // first word of the command line
+  long count;                       // samples
+  double total_us;                  // sum of latencies
+  double max_us;                    // largest latency
+  long buckets[STATS_BUCKETS];      // bucket i: [2^i, 2^(i+1)) us
+  struct command_stats *next;       // next entry in the same hash bucket
+} CommandStats;
+
+// Counters of one tap relay, shared with the shell through MAP_SHARED memory
+typedef struct tap_stats {
+  long long bytes;              // bytes moved downstream
+  long long wait_upstream_ns;   // waiting for the stage before to write
+  long long wait_downstream_ns; // waiting for the stage after to read
+  long long total_ns;           // lifetime of the relay
+} TapStats;
+
+// Shell option toggled by set -o / set +o
+typedef struct shell_option {
+  char *name;
+  bool *value;
+} ShellOption;
+
+// One running par child
+typedef struct par_job {
+  Job *job;   // job table entry, NULL if the slot is free
+  int seq;    // input line number, for -k ordering
+  int out_fd; // memfd collecting output under -k, else STDOUT_FILENO
+} ParJob;
+
+extern char **environ; // passed to spawned children
+
 // Functions
 bool equal(char *a, char *b); // compare two strings
 int fetchline(char **line); // read a line from stdin
 int interactiveShell(); // run interactive shell
-int runTests(); // run test cases
+int runBench(int n); // run the benchmark suite
+int runCommand(char *command); // run osh -c 'command'
+int runScript(char *path); // run osh script
 void processLine(char *line); // process a line of input
 int main(int argc, char **argv); // main function
 void print_ascii_art(); // print ASCII art
+void line_reader_init(LineReader *reader, int fd); // read lines from fd
+char *line_reader_next(LineReader *reader); // next line, NULL at EOF
+void line_reader_free(LineReader *reader); // release the buffer
+void *arena_alloc(Arena *arena, size_t n); // bump-allocate n bytes
+void arena_reset(Arena *arena); // make the whole arena reusable
+Token *lex(char *line, int *count); // split a line into tokens
+char **glob_expand(char *pattern, int *count); // paths matching pattern
+Segment *parse(char *line, int *num_segments); // tokens -> segments
+bool glob_segment(Segment *seg); // expand glob words before running
+pid_t spawn_stage(Command *cmd, int in_fd, int out_fd); // start one stage
+int decode_status(int wstatus); // wait status -> shell exit status
+int execute_single_command(Segment *seg); // run a command
+int execute_pipeline(Segment *seg); // run a | b | ... | z
+int open_pipe(int fds[2]); // pipe2 + $OSH_PIPE_SIZE
+char *path_cache_lookup(char *name); // resolve a command via the hash table
+void path_cache_forget(char *name); // drop one hash table entry
+void path_cache_clear(); // empty the hash table
+int builtin_hash(char **argv); // hash [-r] [name...]
+void usage_add(JobUsage *usage, struct rusage *ru); // fold in one stage
+void print_usage(JobUsage *usage); // "time" report
+void telemetry_record(char *text, JobUsage *usage, int status); // log a command
+int builtin_stats(char **argv); // stats [-r | file]
+int builtin_set(char **argv); // set [-o|+o] option
+bool parse_limit(Limits *limits, char *word); // parse an @name=value prefix
+int apply_limits(Limits *limits); // apply prefixes in the child
+Builtin *find_builtin(char *name); // look up a builtin by name
+int builtin_ascii(char **argv); // ascii
+int builtin_cd(char **argv); // cd [dir | -]
+int builtin_pwd(char **argv); // pwd
+int builtin_echo(char **argv); // echo [-n] args...
+int builtin_true(char **argv); // true
+int builtin_false(char **argv); // false
+int builtin_export(char **argv); // export [NAME=value...]
+int builtin_unset(char **argv); // unset NAME...
+int builtin_exit(char **argv); // exit [n]
+void jobs_init(); // install the SIGCHLD handler
+void block_sigchld(bool block); // guard job table updates
+Job *job_create(int num_pids, char *text, bool background); // new job
+void job_set_pid(Job *job, int s, pid_t pid); // record a stage's child
+void job_remove(Job *job); // free a job
+Job *job_find(int id); // look up %id
+int job_wait(Job *job); // wait for a job to finish and remove it
+void job_notify(bool report); // reap finished jobs from the table
+int builtin_jobs(char **argv); // jobs
+int builtin_wait(char **argv); // wait [%n...]
+int builtin_fg(char **argv); // fg [%n]
+int builtin_par(char **argv); // par [-j N] [-k] cmd {} < list
 
 #endif
\ No newline at end of file
@@ -1,45 +1,106 @@
-/**
- * "Virtual" CPU that also maintains track of system time.
- */
 /**
  * CPU.c
- * Simulates a virtual CPU with dispatch overhead tracking.
- * Maintains global counters for CPU time, dispatch time, and run count.
+ * Simulates virtual CPUs with dispatch overhead tracking.
+ * Maintains per-CPU counters for CPU time, dispatch time, migrations and
+ * run count. Per-task metrics for TAT, WT, RT live in metrics.c.
  */
 
 #include <stdio.h>
-
+#include <stdlib.h>
+#include <string.h>
 
 #include "task.h"
+#include "cpu.h"
+#include "trace.h"
 
-// Bonus: counters for CPU utilization
-int total_cpu_time = 0;
-int total_dispatch_time = 0;
-static int run_count = 0;
-
-// Metrics for TAT, WT, RT
-#define MAX_TASKS 100
-int task_count = 0;
-char *metric_names[MAX_TASKS];
-int metric_arrival[MAX_TASKS];
-int metric_start[MAX_TASKS];
-int metric_finish[MAX_TASKS];
-int metric_burst[MAX_TASKS];
+// Bonus: counters for CPU utilization, one entry per CPU
+_Thread_local CoreStats *cores = NULL;
+_Thread_local int num_cpus = 0;
+_Thread_local int dispatch_cost = DISPATCH_COST;
 
 /**
  * run
- * Simulate execution of a task slice on the CPU.
- * Applies a 1-unit dispatch overhead between task runs.
+ * Simulate execution of a task slice on a CPU.
+ * Applies the dispatch overhead between task runs on the same CPU.
+ * @param cpu   CPU the slice runs on
  * @param task  Pointer to Task being executed
  * @param slice Number of time units to run this task
+ * @param now   Time the slice ends
+ */
+void run(int cpu, Task *task, int slice, int now) {
+    CoreStats *core = &cores[cpu];
+    // dispatch cost before each run after the first
+    if (core->runs > 0) {
+        core->dispatch_time += dispatch_cost;
+    }
+    core->cpu_time += slice;
+    core->runs++;
+    trace_write(TRACE_RUN, task->tid, cpu, now - slice, slice, task->burst);
+    if (!trace_text) return;
+    if (num_cpus > 1) {
+        printf("Running task = [%s] [%d] [%d] for %d units on CPU %d.\n",
+               task->name, task->priority, task->burst, slice, cpu);
+    } else {
+        printf("Running task = [%s] [%d] [%d] for %d units.\n",
+               task->name, task->priority, task->burst, slice);
+    }
+    printf("\tTime is now: %d\n", now);
+}
+
+/**
+ * migrate
+ * Account for a task resuming on a CPU other than the one it last ran on.
+ * @param cpu   CPU the task moves to
+ * @param task  Task being moved
+ * @param units Time units the move costs
+ * @param now   Time the move starts
+ */
+void migrate(int cpu, Task *task, int units, int now) {
+    cores[cpu].migrations++;
+    cores[cpu].migration_time += units;
+    trace_write(TRACE_MIGRATE, task->tid, cpu, now, units, task->cpu);
+    if (!trace_text) return;
+    printf("Migrating task = [%s] from CPU %d to CPU %d.\n", task->name, task->cpu, cpu);
+}
+
+/**
+ * cut_migration
+ * Give back the part of a migration penalty that was never spent because
+ * the task was preempted while still moving.
+ * @param cpu   CPU the task was moving to
+ * @param units Time units of the penalty left
  */
-void run(Task *task, int slice) {
-    // dispatch cost (1 unit) before each run after the first
-    if (run_count > 0) {
-        total_dispatch_time += 1;
+void cut_migration(int cpu, int units) {
+    cores[cpu].migration_time -= units;
+}
+
+/**
+ * idle
+ * Account for time with no task ready to run.
+ * @param cpu   CPU that is idle
+ * @param units Number of time units the CPU is idle
+ * @param now   Time the CPU picks up work again
+ */
+void idle(int cpu, int units, int now) {
+    cores[cpu].idle_time += units;
+    trace_write(TRACE_IDLE, -1, cpu, now - units, units, 0);
+    if (!trace_text) return;
+    if (num_cpus > 1) {
+        printf("CPU %d idle for %d units.\n", cpu, units);
+    } else {
+        printf("CPU idle for %d units.\n", units);
     }
-    total_cpu_time += slice;
-    run_count++;
-    printf("Running task = [%s] [%d] [%d] for %d units.\n",
-           task->name, task->priority, task->burst, slice);
+    printf("\tTime is now: %d\n", now);
+}
+
+/**
+ * cpu_init
+ * Clear the counters of every CPU so another policy can run on the same
+ * workload.
+ * @param cpus  Number of CPUs to simulate
+ */
+void cpu_init(int cpus) {
+    cores = realloc(cores, cpus * sizeof(CoreStats));
+    memset(cores, 0, cpus * sizeof(CoreStats));
+    num_cpus = cpus;
 }
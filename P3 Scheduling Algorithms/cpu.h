@@ -1,5 +1,46 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include "task.h"
+
 // length of a time quantum
 #define QUANTUM 10
 
-// run the specified task for the following time slice
-void run(Task *task, int slice);
+// default dispatcher cost per run after the first
+#define DISPATCH_COST 1
+
+// units a task loses when it resumes on a different CPU than it last ran on
+#define MIGRATION_PENALTY 2
+
+// counters of one simulated CPU
+typedef struct core_stats {
+    long cpu_time;          // units spent running tasks
+    long dispatch_time;     // dispatcher cost of every run after the first
+    long migration_time;    // units lost to migration penalties
+    long idle_time;         // units with nothing to run
+    long runs;              // slices dispatched
+    long migrations;        // slices that started on a new CPU
+} CoreStats;
+
+extern _Thread_local CoreStats *cores;
+extern _Thread_local int num_cpus;
+
+// units each dispatch after a CPU's first costs
+extern _Thread_local int dispatch_cost;
+
+// run the specified task for the time slice ending at now
+void run(int cpu, Task *task, int slice, int now);
+
+// charge a migration penalty before a task's slice starting at now
+void migrate(int cpu, Task *task, int units, int now);
+
+// refund the units of a migration penalty cut short by a preemption
+void cut_migration(int cpu, int units);
+
+// let the CPU sit idle until now, the next arrival
+void idle(int cpu, int units, int now);
+
+// reset the counters of cpus CPUs before another schedule
+void cpu_init(int cpus);
+
+#endif
@@ -3,101 +3,341 @@
  *
  * Schedule is in the format
  *
- *  [name] [priority] [CPU burst]
+ *  [name] [priority] [CPU burst] [arrival]
+ *
+ * where the arrival column is optional and defaults to 0. See parser.h.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "task.h"
 #include "list.h"
 #include "schedulers.h"
 #include "cpu.h"
-extern int total_cpu_time;
-extern int total_dispatch_time;
+#include "metrics.h"
+#include "live.h"
+#include "trace.h"
+#include "parser.h"
+#include "sweep.h"
+#include "stats.h"
 
-extern int task_count;
-extern char *metric_names[];
-extern int metric_arrival[];
-extern int metric_start[];
-extern int metric_finish[];
-extern int metric_burst[];
+// largest workload whose per-task table is printed without --table
+#define TABLE_MAX_TASKS 20
 
-#define SIZE    100
+static Parser parser;
+static int stream = 0;          // feed tasks to the first run as they are parsed
+static int last_arrival = 0;
+static int table = -1;          // per-task table: 1 always, 0 never, -1 small workloads
 
 /**
- * main
- * Entry point for scheduling simulation.
- * Opens the input file, parses tasks, runs the scheduler,
- * and outputs CPU utilization and task metrics.
- * @param argc Number of command-line arguments
- * @param argv Array of argument strings (argv[1] is task file)
- * @return Exit status (0 for success)
+ * show_table
+ * @return Nonzero if the per-task table is printed for the loaded workload
  */
-int main(int argc, char *argv[])
-{
-    FILE *in;
-    char *temp;
-    char task[SIZE];
-
-    char *name;
-    int priority;
-    int burst;
-
-    in = fopen(argv[1],"r");
-    // Open the task definition file for reading
-    
-    while (fgets(task,SIZE,in) != NULL) {
-        temp = strdup(task);
-        name = strsep(&temp,",");
-        priority = atoi(strsep(&temp,","));
-        burst = atoi(strsep(&temp,","));
-
-        // add the task to the scheduler's list of tasks
-        add(name,priority,burst);
+static int show_table(void) {
+    return table > 0 || (table < 0 && metrics.count <= TABLE_MAX_TASKS);
+}
 
-        free(temp);
+/**
+ * report
+ * Output CPU utilization, the per-task metrics when the table is on, and
+ * the TAT/WT/RT distribution of the last schedule.
+ */
+static void report(void) {
+    // output CPU utilization including dispatcher cost, migrations and idle time
+    long busy = 0, total = 0, max_busy = 0;
+    for (int c = 0; c < num_cpus; c++) {
+        long core_total = cores[c].cpu_time + cores[c].dispatch_time +
+                          cores[c].migration_time + cores[c].idle_time;
+        busy += cores[c].cpu_time;
+        total += core_total;
+        if (cores[c].cpu_time > max_busy) max_busy = cores[c].cpu_time;
     }
+    double util = total > 0 ? (double)busy * 100.0 / total : 0;
+    printf("CPU Utilization: %.2f%%\n", util);
 
-    // Close the input file
-    fclose(in);
-
-    // invoke the scheduler
-    schedule();
+    // per-CPU breakdown; imbalance is how far the busiest CPU is above the mean
+    if (num_cpus > 1) {
+        for (int c = 0; c < num_cpus; c++) {
+            long core_total = cores[c].cpu_time + cores[c].dispatch_time +
+                              cores[c].migration_time + cores[c].idle_time;
+            printf("CPU %d: utilization %.2f%%, busy %ld, dispatches %ld, migrations %ld\n",
+                   c, core_total ? (double)cores[c].cpu_time * 100.0 / core_total : 0.0,
+                   cores[c].cpu_time, cores[c].runs, cores[c].migrations);
+        }
+        double mean = (double)busy / num_cpus;
+        printf("Load imbalance: %.2f%%\n", mean > 0 ? (max_busy / mean - 1) * 100.0 : 0.0);
+    }
 
-    // output CPU utilization including dispatcher cost
-    double util = (double)total_cpu_time * 100.0 /
-                  (total_cpu_time + total_dispatch_time);
-    printf("CPU Utilization: %.2f%%\n", util);
+    if (!show_table()) {
+        stats_report();
+        return;
+    }
 
     // Print table header with task names
     printf("\n...|");
-    for (int i = 0; i < task_count; i++) {
-        printf(" %2s |", metric_names[i]);
+    for (int i = 0; i < metrics.count; i++) {
+        printf(" %2s |", metrics.name[i]);
     }
     printf("\n");
     // Print Turn-Around Time for each task
     printf("TAT|");
-    for (int i = 0; i < task_count; i++) {
-        int tat = metric_finish[i] - metric_arrival[i];
+    for (int i = 0; i < metrics.count; i++) {
+        int tat = metrics.finish[i] - metrics.arrival[i];
         printf(" %2d |", tat);
     }
     printf("\n");
     // Print Waiting Time for each task
     printf("WT |");
-    for (int i = 0; i < task_count; i++) {
-        int wt = (metric_finish[i] - metric_arrival[i]) - metric_burst[i];
+    for (int i = 0; i < metrics.count; i++) {
+        int wt = (metrics.finish[i] - metrics.arrival[i]) - metrics.burst[i];
         printf(" %2d |", wt);
     }
     printf("\n");
     // Print Response Time for each task
     printf("RT |");
-    for (int i = 0; i < task_count; i++) {
-        int rt = metric_start[i] - metric_arrival[i];
+    for (int i = 0; i < metrics.count; i++) {
+        int rt = metrics.start[i] - metrics.arrival[i];
         printf(" %2d |", rt);
     }
     printf("\n");
 
+    stats_report();
+}
+
+/**
+ * stream_next
+ * Parse the next task of the task file into the workload. A malformed
+ * line ends the program; so does an arrival earlier than the one before
+ * when streaming, since the simulation has already passed it.
+ * @return The task's id, or -1 at the end of the file
+ */
+static int stream_next(void) {
+    TaskLine line;
+    int status = parser_next(&parser, &line);
+    if (status < 0) exit(1);
+    if (status == 0) return -1;
+    if (stream && line.arrival < last_arrival) {
+        fprintf(stderr, "%s:%d: arrival %d is before %d; --stream needs tasks in arrival order\n",
+                parser.path, parser.line, line.arrival, last_arrival);
+        exit(1);
+    }
+    last_arrival = line.arrival;
+    return metrics_add(line.name, line.name_length, line.priority, line.burst, line.arrival);
+}
+
+/**
+ * usage
+ * Print the command line syntax and exit.
+ * @param prog  Program name
+ */
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [--policy=NAME[,NAME...]|all] [--quantum=N] [--cpus=N]\n"
+                    "       [--migration=N] [--live[=WORKERS]] [--unit-us=N]\n"
+                    "       [--trace=FILE] [--text|--quiet] [--table|--no-table] [--stream]\n"
+                    "       [--mlfq-levels=N] [--mlfq-quanta=Q0,Q1,...] [--mlfq-boost=N] [--mlfq-age=N]\n"
+                    "       [--dispatch=N] [--sweep NAME=FIRST[..LAST[:STEP]]...] [--jobs=N] taskfile\n"
+                    "sweepable: quantum dispatch migration cpus\n", prog);
+    fprintf(stderr, "policies:");
+    for (int i = 0; i < policy_count; i++) {
+        fprintf(stderr, " %s", policies[i]->name);
+    }
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+/**
+ * parse_quanta
+ * Parse a --mlfq-quanta list into the per-level quanta; levels past the
+ * end of the list keep the default.
+ * @param list  Comma-separated quanta, top level first
+ * @return 0 on success, -1 if a quantum is not positive or there are too many
+ */
+static int parse_quanta(const char *list) {
+    int level = 0;
+    char *quanta = strdup(list), *rest = quanta, *value;
+    while ((value = strsep(&rest, ",")) != NULL) {
+        if (level == MLFQ_MAX_LEVELS || atoi(value) <= 0) {
+            free(quanta);
+            return -1;
+        }
+        mlfq_quanta[level++] = atoi(value);
+    }
+    free(quanta);
+    return 0;
+}
+
+/**
+ * select_policies
+ * Parse a --policy list into the policies to run.
+ * @param list      Comma-separated policy names, or "all"
+ * @param selected  Receives the chosen policies
+ * @return Number of policies chosen, 0 if a name is unknown
+ */
+static int select_policies(char *list, Policy **selected) {
+    if (strcmp(list, "all") == 0) {
+        for (int i = 0; i < policy_count; i++) {
+            selected[i] = policies[i];
+        }
+        return policy_count;
+    }
+    int n = 0;
+    char *names = strdup(list), *rest = names, *name;
+    while ((name = strsep(&rest, ",")) != NULL) {
+        Policy *policy = find_policy(name);
+        if (policy == NULL || n == policy_count) {
+            fprintf(stderr, "unknown policy: %s\n", name);
+            free(names);
+            return 0;
+        }
+        selected[n++] = policy;
+    }
+    free(names);
+    return n;
+}
+
+/**
+ * main
+ * Entry point for scheduling simulation.
+ * Parses the task file once, then runs it under each selected policy
+ * and outputs CPU utilization and task metrics for each. With --live the
+ * same policy then drives real worker threads and the measured metrics
+ * are printed next to the simulated ones.
+ * Without --policy, a binary named after a policy (./rr) runs that policy
+ * and any other name runs all of them.
+ * @param argc Number of command-line arguments
+ * @param argv Options followed by the task file
+ * @return Exit status (0 for success)
+ */
+int main(int argc, char *argv[])
+{
+    Policy *selected[policy_count];
+    int num_selected = 0;
+    char *file = NULL;
+    int live_workers = 0;
+    char *trace = NULL;
+    int text = -1;
+    int sweeping = 0;
+    int jobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--policy=", 9) == 0) {
+            num_selected = select_policies(argv[i] + 9, selected);
+            if (num_selected == 0) usage(argv[0]);
+        } else if (strncmp(argv[i], "--quantum=", 10) == 0) {
+            quantum = atoi(argv[i] + 10);
+            if (quantum <= 0) usage(argv[0]);
+        } else if (strncmp(argv[i], "--cpus=", 7) == 0) {
+            cpus = atoi(argv[i] + 7);
+            if (cpus <= 0) usage(argv[0]);
+        } else if (strncmp(argv[i], "--migration=", 12) == 0) {
+            migration_penalty = atoi(argv[i] + 12);
+            if (migration_penalty < 0) usage(argv[0]);
+        } else if (strcmp(argv[i], "--live") == 0) {
+            live_workers = -1;
+        } else if (strncmp(argv[i], "--live=", 7) == 0) {
+            live_workers = atoi(argv[i] + 7);
+            if (live_workers <= 0) usage(argv[0]);
+        } else if (strncmp(argv[i], "--unit-us=", 10) == 0) {
+            live_unit_us = atoi(argv[i] + 10);
+            if (live_unit_us <= 0) usage(argv[0]);
+        } else if (strncmp(argv[i], "--trace=", 8) == 0) {
+            trace = argv[i] + 8;
+        } else if (strcmp(argv[i], "--text") == 0) {
+            text = 1;
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            text = 0;
+        } else if (strncmp(argv[i], "--mlfq-levels=", 14) == 0) {
+            mlfq_levels = atoi(argv[i] + 14);
+            if (mlfq_levels < 1 || mlfq_levels > MLFQ_MAX_LEVELS) usage(argv[0]);
+        } else if (strncmp(argv[i], "--mlfq-quanta=", 14) == 0) {
+            if (parse_quanta(argv[i] + 14) != 0) usage(argv[0]);
+        } else if (strncmp(argv[i], "--mlfq-boost=", 13) == 0) {
+            mlfq_boost = atoi(argv[i] + 13);
+            if (mlfq_boost < 0) usage(argv[0]);
+        } else if (strncmp(argv[i], "--mlfq-age=", 11) == 0) {
+            mlfq_age = atoi(argv[i] + 11);
+            if (mlfq_age < 0) usage(argv[0]);
+        } else if (strcmp(argv[i], "--table") == 0) {
+            table = 1;
+        } else if (strcmp(argv[i], "--no-table") == 0) {
+            table = 0;
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            stream = 1;
+        } else if (strncmp(argv[i], "--dispatch=", 11) == 0) {
+            dispatch_cost = atoi(argv[i] + 11);
+            if (dispatch_cost < 0) usage(argv[0]);
+        } else if (strcmp(argv[i], "--sweep") == 0) {
+            sweeping = 1;
+        } else if (sweeping && sweep_param(argv[i]) >= 0) {
+            if (sweep_add(argv[i]) != 0) {
+                fprintf(stderr, "bad sweep range: %s\n", argv[i]);
+                usage(argv[0]);
+            }
+        } else if (strncmp(argv[i], "--jobs=", 7) == 0) {
+            jobs = atoi(argv[i] + 7);
+            if (jobs <= 0) usage(argv[0]);
+        } else if (argv[i][0] == '-' || file != NULL) {
+            usage(argv[0]);
+        } else {
+            file = argv[i];
+        }
+    }
+    if (file == NULL) usage(argv[0]);
+    // a sweep tabulates results only and needs the whole workload up front
+    if (sweeping && (sweep_ranges() == 0 || live_workers != 0 || trace != NULL || stream ||
+                     text > 0)) {
+        usage(argv[0]);
+    }
+    if (jobs <= 0) jobs = 1;
+    // --live without a count uses one worker per simulated CPU
+    if (live_workers < 0) live_workers = cpus;
+    // a traced run is a benchmark: per-slice text only when asked for
+    trace_text = text >= 0 ? text : trace == NULL && !sweeping;
+    if (trace != NULL && trace_open(trace) != 0) {
+        perror(trace);
+        return 1;
+    }
+    if (num_selected == 0) {
+        char *prog = strrchr(argv[0], '/');
+        Policy *policy = find_policy(prog ? prog + 1 : argv[0]);
+        if (policy != NULL) {
+            selected[num_selected++] = policy;
+        } else {
+            num_selected = select_policies("all", selected);
+        }
+    }
+
+    if (parser_open(&parser, file) != 0) return 1;
+    if (!stream) {
+        // load the whole workload, then simulate
+        while (stream_next() >= 0) {
+        }
+    }
+
+    if (sweeping) {
+        sweep_run(selected, num_selected, jobs);
+        parser_close(&parser);
+        return 0;
+    }
+
+    // invoke the scheduler once per policy over the same workload; when
+    // streaming, the first run reads it and the others reuse it
+    for (int i = 0; i < num_selected; i++) {
+        if (num_selected > 1) {
+            printf("%s==> %s <==\n", i > 0 ? "\n" : "", selected[i]->name);
+        }
+        schedule_from(selected[i], stream && i == 0 ? stream_next : NULL);
+        report();
+        if (live_workers > 0) {
+            live_run(selected[i], live_workers);
+            live_report(show_table());
+        }
+    }
+    trace_close();
+    parser_close(&parser);
+
     return 0;
 }
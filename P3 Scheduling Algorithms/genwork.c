@@ -0,0 +1,253 @@
+/**
+ * genwork.c
+ * Deterministic synthetic workloads in the driver's task file format:
+ *
+ *  genwork [--seed=N] [--tasks=N] [--burst=DIST] [--rate=R]
+ *          [--priorities=P:W[,P:W...]] [outfile]
+ *
+ * DIST is one of
+ *  exp:MEAN                exponential bursts (default exp:20)
+ *  bimodal:SHORT,LONG,P    exponential around SHORT with probability P,
+ *                          else around LONG (interactive/batch mixes)
+ *  pareto:ALPHA,MIN        heavy-tailed bursts of at least MIN
+ *  fixed:N                 every burst N
+ * Arrivals are a Poisson process of R tasks per time unit (default 0: all
+ * tasks arrive at time 0); a workload whose arrivals would pass INT_MAX is
+ * refused, since sched could not read it. Priorities are drawn with the
+ * given weights, uniformly over MIN_PRIORITY..MAX_PRIORITY by default. The
+ * same seed and options always produce the same file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <math.h>
+
+#include "schedulers.h"
+
+// longest burst written; keeps heavy tails inside an int schedule
+#define MAX_BURST 1000000
+
+enum { BURST_EXP, BURST_BIMODAL, BURST_PARETO, BURST_FIXED };
+
+typedef struct distribution {
+    int kind;
+    double a, b, p;     // MEAN | SHORT, LONG, P | ALPHA, MIN | N
+} Distribution;
+
+static uint64_t rng_state;
+
+/**
+ * next_random
+ * splitmix64, so output does not depend on the C library's rand().
+ */
+static uint64_t next_random() {
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * uniform
+ * A double in (0, 1].
+ */
+static double uniform() {
+    return ((next_random() >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+static double exponential(double mean) {
+    return -mean * log(uniform());
+}
+
+/**
+ * draw_burst
+ * One burst from the distribution, rounded up and clamped to 1..MAX_BURST.
+ */
+static int draw_burst(const Distribution *d) {
+    double value;
+    switch (d->kind) {
+    case BURST_BIMODAL:
+        value = exponential(uniform() <= d->p ? d->a : d->b);
+        break;
+    case BURST_PARETO:
+        value = d->b / pow(uniform(), 1.0 / d->a);
+        break;
+    case BURST_FIXED:
+        value = d->a;
+        break;
+    default:
+        value = exponential(d->a);
+        break;
+    }
+    if (value < 1) return 1;
+    if (value > MAX_BURST) return MAX_BURST;
+    return (int)ceil(value);
+}
+
+/**
+ * parse_burst
+ * Parse a --burst distribution.
+ * @return 0 on success, -1 if invalid
+ */
+static int parse_burst(const char *text, Distribution *d) {
+    int used = 0;
+    memset(d, 0, sizeof(*d));
+    if (sscanf(text, "exp:%lf%n", &d->a, &used) == 1 && d->a > 0) {
+        d->kind = BURST_EXP;
+    } else if (sscanf(text, "bimodal:%lf,%lf,%lf%n", &d->a, &d->b, &d->p, &used) == 3 &&
+               d->a > 0 && d->b > 0 && d->p >= 0 && d->p <= 1) {
+        d->kind = BURST_BIMODAL;
+    } else if (sscanf(text, "pareto:%lf,%lf%n", &d->a, &d->b, &used) == 2 &&
+               d->a > 0 && d->b > 0) {
+        d->kind = BURST_PARETO;
+    } else if (sscanf(text, "fixed:%lf%n", &d->a, &used) == 1 && d->a >= 1) {
+        d->kind = BURST_FIXED;
+    } else {
+        return -1;
+    }
+    return text[used] == '\0' ? 0 : -1;
+}
+
+/**
+ * parse_number
+ * Parse a whole option value as a non-negative number.
+ * @return 0 on success, -1 if empty, negative or followed by junk
+ */
+static int parse_number(const char *text, double *value) {
+    char *end;
+    *value = strtod(text, &end);
+    return end == text || *end != '\0' || !(*value >= 0) ? -1 : 0;
+}
+
+/**
+ * parse_count
+ * Parse a whole option value as a non-negative integer.
+ * @return 0 on success, -1 if empty, negative, too large or followed by junk
+ */
+static int parse_count(const char *text, unsigned long long *value) {
+    char *end;
+    errno = 0;
+    *value = strtoull(text, &end, 10);
+    return end == text || *end != '\0' || text[0] == '-' || errno != 0 ? -1 : 0;
+}
+
+/**
+ * parse_priorities
+ * Parse a P:W[,P:W...] priority mix.
+ * @param text     The mix
+ * @param weights  Receives the weight of each priority from MIN_PRIORITY
+ * @return 0 on success, -1 if invalid or every weight is 0
+ */
+static int parse_priorities(const char *text, double *weights) {
+    int levels = MAX_PRIORITY - MIN_PRIORITY + 1;
+    double total = 0;
+    for (int i = 0; i < levels; i++) weights[i] = 0;
+    while (*text != '\0') {
+        int priority, used;
+        double weight;
+        if (sscanf(text, "%d:%lf%n", &priority, &weight, &used) != 2 ||
+            priority < MIN_PRIORITY || priority > MAX_PRIORITY || weight < 0) {
+            return -1;
+        }
+        weights[priority - MIN_PRIORITY] += weight;
+        total += weight;
+        text += used;
+        if (*text == ',') text++;
+        else if (*text != '\0') return -1;
+    }
+    return total > 0 ? 0 : -1;
+}
+
+/**
+ * draw_priority
+ * One priority from the weighted mix.
+ */
+static int draw_priority(const double *weights, double total) {
+    double x = uniform() * total;
+    int last = MIN_PRIORITY;
+    for (int p = MIN_PRIORITY; p <= MAX_PRIORITY; p++) {
+        if (weights[p - MIN_PRIORITY] <= 0) continue;
+        last = p;
+        x -= weights[p - MIN_PRIORITY];
+        if (x <= 0) return p;
+    }
+    return last;
+}
+
+/**
+ * usage
+ * Print the command line syntax and exit.
+ */
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [--seed=N] [--tasks=N] [--burst=DIST] [--rate=R]\n"
+                    "       [--priorities=P:W[,P:W...]] [outfile]\n"
+                    "DIST: exp:MEAN | bimodal:SHORT,LONG,P | pareto:ALPHA,MIN | fixed:N\n", prog);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long long seed = 1;
+    long tasks = 1000;
+    double rate = 0;
+    Distribution burst = {BURST_EXP, 20, 0, 0};
+    double weights[MAX_PRIORITY - MIN_PRIORITY + 1];
+    char *file = NULL;
+
+    for (int i = 0; i <= MAX_PRIORITY - MIN_PRIORITY; i++) weights[i] = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--seed=", 7) == 0) {
+            if (parse_count(argv[i] + 7, &seed) != 0) usage(argv[0]);
+        } else if (strncmp(argv[i], "--tasks=", 8) == 0) {
+            unsigned long long count;
+            if (parse_count(argv[i] + 8, &count) != 0 || count > LONG_MAX) usage(argv[0]);
+            tasks = count;
+        } else if (strncmp(argv[i], "--burst=", 8) == 0) {
+            if (parse_burst(argv[i] + 8, &burst) != 0) usage(argv[0]);
+        } else if (strncmp(argv[i], "--rate=", 7) == 0) {
+            if (parse_number(argv[i] + 7, &rate) != 0) usage(argv[0]);
+        } else if (strncmp(argv[i], "--priorities=", 13) == 0) {
+            if (parse_priorities(argv[i] + 13, weights) != 0) usage(argv[0]);
+        } else if (argv[i][0] == '-' || file != NULL) {
+            usage(argv[0]);
+        } else {
+            file = argv[i];
+        }
+    }
+
+    FILE *out = stdout;
+    if (file != NULL && (out = fopen(file, "w")) == NULL) {
+        perror(file);
+        return 1;
+    }
+    static char buffer[1 << 16];
+    setvbuf(out, buffer, _IOFBF, sizeof(buffer));
+
+    double total = 0;
+    for (int i = 0; i <= MAX_PRIORITY - MIN_PRIORITY; i++) total += weights[i];
+
+    rng_state = seed;
+    double clock = 0;
+    for (long i = 1; i <= tasks; i++) {
+        if (rate > 0 && i > 1) clock += exponential(1.0 / rate);
+        if (clock > INT_MAX) {
+            // sched reads arrivals as int; a longer file would be rejected
+            fprintf(stderr, "%s: task %ld arrives after time %d; raise --rate or lower --tasks\n",
+                    argv[0], i, INT_MAX);
+            fclose(out);
+            if (file != NULL) remove(file);
+            return 1;
+        }
+        int priority = draw_priority(weights, total);
+        fprintf(out, "T%ld, %d, %d, %ld\n", i, priority, draw_burst(&burst), (long)clock);
+    }
+
+    if (fclose(out) != 0) {
+        perror(file ? file : "stdout");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+/**
+ * heap.c
+ * 4-ary heap used as the ready queue of the ordered policies.
+ * A 4-ary heap is half as deep as a binary one and keeps each node's
+ * children in one cache line, which pays off on pops of large queues.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "heap.h"
+
+/**
+ * sift_up
+ * Move the task in a slot towards the root until its parent comes first.
+ */
+static void sift_up(Heap *heap, int slot) {
+    Task *task = heap->items[slot];
+    while (slot > 0) {
+        int parent = (slot - 1) / HEAP_ARITY;
+        if (!heap->before(task, heap->items[parent])) break;
+        heap->items[slot] = heap->items[parent];
+        slot = parent;
+    }
+    heap->items[slot] = task;
+}
+
+/**
+ * sift_down
+ * Move the task in a slot towards the leaves until no child comes first.
+ */
+static void sift_down(Heap *heap, int slot) {
+    Task *task = heap->items[slot];
+    while (true) {
+        int first = slot * HEAP_ARITY + 1;
+        if (first >= heap->count) break;
+        int last = first + HEAP_ARITY < heap->count ? first + HEAP_ARITY : heap->count;
+        int best = first;
+        for (int child = first + 1; child < last; child++) {
+            if (heap->before(heap->items[child], heap->items[best])) best = child;
+        }
+        if (!heap->before(heap->items[best], task)) break;
+        heap->items[slot] = heap->items[best];
+        slot = best;
+    }
+    heap->items[slot] = task;
+}
+
+/**
+ * heap_init
+ * Empty the heap, reusing its item buffer.
+ * @param heap      Heap to reset
+ * @param before    Ordering: true if a must be picked before b
+ */
+void heap_init(Heap *heap, bool (*before)(Task *a, Task *b)) {
+    heap->count = 0;
+    heap->before = before;
+}
+
+/**
+ * heap_push
+ * Insert a task, growing the heap when full.
+ * @param heap  Heap to insert into
+ * @param task  Task to insert
+ */
+void heap_push(Heap *heap, Task *task) {
+    if (heap->count == heap->capacity) {
+        heap->capacity = heap->capacity ? heap->capacity * 2 : 1024;
+        heap->items = realloc(heap->items, heap->capacity * sizeof(Task *));
+    }
+    heap->items[heap->count++] = task;
+    sift_up(heap, heap->count - 1);
+}
+
+/**
+ * heap_pop
+ * Remove the task that comes first.
+ * @param heap  Heap to remove from
+ * @return The first task, or NULL if the heap is empty
+ */
+Task *heap_pop(Heap *heap) {
+    if (heap->count == 0) return NULL;
+    Task *top = heap->items[0];
+    if (--heap->count > 0) {
+        heap->items[0] = heap->items[heap->count];
+        sift_down(heap, 0);
+    }
+    return top;
+}
+
+/**
+ * heap_peek
+ * @param heap  Heap to look at
+ * @return The task that would be popped next, or NULL if empty
+ */
+Task *heap_peek(Heap *heap) {
+    return heap->count ? heap->items[0] : NULL;
+}
@@ -0,0 +1,34 @@
+/**
+ * heap.h
+ * 4-ary min-heap of tasks, ordered by a policy's comparator.
+ */
+
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <stdbool.h>
+#include "task.h"
+
+// children per heap node
+#define HEAP_ARITY 4
+
+typedef struct heap {
+    Task **items;                       // heap-ordered tasks
+    int count;                          // tasks in the heap
+    int capacity;                       // slots in items
+    bool (*before)(Task *a, Task *b);   // true if a must be picked before b
+} Heap;
+
+// empty the heap
+void heap_init(Heap *heap, bool (*before)(Task *a, Task *b));
+
+// insert a task
+void heap_push(Heap *heap, Task *task);
+
+// remove and return the first task, NULL if empty
+Task *heap_pop(Heap *heap);
+
+// first task without removing it, NULL if empty
+Task *heap_peek(Heap *heap);
+
+#endif
@@ -1,74 +1,54 @@
-/**
- * Various list operations
- */
 /**
  * list.c
- * Utility functions for managing linked lists of Task nodes.
- * Provides insert, delete, and traverse operations.
+ * FIFO queues of tasks linked through a successor array.
  */
- 
+
 #include <stdlib.h>
-#include <stdio.h>
-#include <string.h>
 
 #include "list.h"
 #include "task.h"
 
-
 /**
- * insert
- * Insert a new Task node at the head of the list.
- * @param head      Pointer to list head pointer
- * @param newTask   Task to insert
+ * queue_init
+ * Empty a FIFO queue.
+ * @param queue     Queue to reset
  */
-void insert(struct node **head, Task *newTask) {
-    // add the new task to the list 
-    struct node *newNode = malloc(sizeof(struct node));
-
-    newNode->task = newTask;
-    newNode->next = *head;
-    *head = newNode;
+void queue_init(Queue *queue) {
+    queue->head = NULL;
+    queue->tail = NULL;
 }
 
 /**
- * delete
- * Remove a specific Task from the list by matching name.
- * @param head      Pointer to list head pointer
- * @param task      Task to remove
+ * queue_push
+ * Append a task to the tail of a FIFO queue.
+ * @param queue     Queue to append to
+ * @param task      Task to append
+ * @param next      Successor of each task id, shared by the policy's queues
  */
-void delete(struct node **head, Task *task) {
-    struct node *temp;
-    struct node *prev;
-
-    temp = *head;
-    // special case - beginning of list
-    if (strcmp(task->name,temp->task->name) == 0) {
-        *head = (*head)->next;
-    }
-    else {
-        // interior or last element in the list
-        prev = *head;
-        temp = temp->next;
-        while (strcmp(task->name,temp->task->name) != 0) {
-            prev = temp;
-            temp = temp->next;
-        }
-
-        prev->next = temp->next;
+void queue_push(Queue *queue, Task *task, Task **next) {
+    next[task->tid] = NULL;
+    if (queue->head == NULL) {
+        queue->head = task;
+    } else {
+        next[queue->tail->tid] = task;
     }
+    queue->tail = task;
 }
 
 /**
- * traverse
- * Print all tasks in the list for debugging purposes.
- * @param head      Head of the list to traverse
+ * queue_pop
+ * Remove the task at the head of a FIFO queue.
+ * @param queue     Queue to remove from
+ * @param next      Successor of each task id
+ * @return The head task, or NULL if the queue is empty
  */
-void traverse(struct node *head) {
-    struct node *temp;
-    temp = head;
-
-    while (temp != NULL) {
-        printf("[%s] [%d] [%d]\n",temp->task->name, temp->task->priority, temp->task->burst);
-        temp = temp->next;
+Task *queue_pop(Queue *queue, Task **next) {
+    Task *task = queue->head;
+    if (task != NULL) {
+        queue->head = next[task->tid];
+        if (queue->head == NULL) {
+            queue->tail = NULL;
+        }
     }
+    return task;
 }
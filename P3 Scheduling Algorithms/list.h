@@ -1,15 +1,30 @@
 /**
- * list data structure containing the tasks in the system
+ * list.h
+ * FIFO ready queues of the round-robin policies.
  */
 
+#ifndef LIST_H
+#define LIST_H
+
 #include "task.h"
 
-struct node {
-    Task *task;
-    struct node *next;
-};
+/**
+ * FIFO of tasks linked through a successor array indexed by task id.
+ * A task sits in at most one queue at a time, so every queue of a policy
+ * can share one array and enqueueing never allocates.
+ */
+typedef struct queue {
+    Task *head;
+    Task *tail;
+} Queue;
+
+// empty a queue
+void queue_init(Queue *queue);
+
+// append a task; next is the shared successor array
+void queue_push(Queue *queue, Task *task, Task **next);
+
+// remove and return the head, NULL if empty
+Task *queue_pop(Queue *queue, Task **next);
 
-// insert and delete operations.
-void insert(struct node **head, Task *task);
-void delete(struct node **head, Task *task);
-void traverse(struct node *head);
+#endif
@@ -0,0 +1,395 @@
+/**
+ * live.c
+ * Live execution mode.
+ * The main thread is the dispatcher: it runs the policy single-threaded
+ * over one ready queue, releases tasks at their real arrival times and
+ * pushes each picked slice onto the least full worker deque. Each worker
+ * takes slices from its own deque first and steals from the others when
+ * it runs dry. The deques are Chase-Lev deques whose only owner is the
+ * dispatcher, which pushes; workers only steal, so no locks are needed.
+ * Finished slices come back on a lock-free stack.
+ * A slice of n units spins for n * live_unit_us of calibrated work, so
+ * contention between workers shows up in the measured times.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "task.h"
+#include "schedulers.h"
+#include "metrics.h"
+#include "live.h"
+
+int live_unit_us = LIVE_UNIT_US;
+
+// one slice handed to a worker; each task has at most one in flight
+typedef struct live_slice {
+    Task *task;
+    int units;                  // units to spin
+    int worker;                 // worker that ran it
+    long long start_ns;         // when the worker began spinning
+    long long end_ns;           // when it finished
+    struct live_slice *next;    // link in the finished stack
+} LiveSlice;
+
+// Chase-Lev deque; the dispatcher pushes at the bottom, workers steal at the top
+typedef struct deque {
+    _Atomic long top;
+    _Atomic long bottom;
+    _Atomic(LiveSlice *) items[LIVE_DEQUE_SIZE];
+} Deque;
+
+typedef struct worker {
+    pthread_t thread;
+    int id;
+} Worker;
+
+static Deque *deques = NULL;
+static int num_workers = 0;
+static _Atomic(LiveSlice *) finished = NULL;
+static atomic_int stop = 0;
+static double spins_per_us = 0;
+
+// measured times, ns since the start of the live run; simulated copies
+static long long *live_arrival = NULL;
+static long long *live_start = NULL;
+static long long *live_finish = NULL;
+static int *sim_start = NULL;
+static int *sim_finish = NULL;
+static int live_workers = 0;
+static long live_steals = 0;
+
+/**
+ * now_ns
+ * Monotonic wall clock in nanoseconds.
+ */
+static long long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * spin
+ * Burn a fixed amount of CPU work.
+ * @param iterations  Loop iterations, from calibrate()
+ */
+static void spin(long iterations) {
+    volatile long sink = 0;
+    for (long i = 0; i < iterations; i++) {
+        sink += i;
+    }
+}
+
+/**
+ * calibrate
+ * Measure spin() iterations per microsecond on an idle CPU, once.
+ */
+static void calibrate() {
+    if (spins_per_us > 0) return;
+    long iterations = 1 << 20;
+    long long elapsed;
+    do {
+        iterations *= 2;
+        long long start = now_ns();
+        spin(iterations);
+        elapsed = now_ns() - start;
+    } while (elapsed < 50000000LL);   // at least 50 ms for a stable rate
+    spins_per_us = iterations * 1000.0 / elapsed;
+}
+
+/**
+ * deque_push
+ * Push a slice at the bottom; only the dispatcher calls this.
+ */
+static void deque_push(Deque *deque, LiveSlice *slice) {
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    atomic_store_explicit(&deque->items[bottom & (LIVE_DEQUE_SIZE - 1)], slice,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+}
+
+/**
+ * deque_steal
+ * Take the oldest slice from the top; any worker may call this.
+ * @return The slice, or NULL if the deque was empty or another thief won
+ */
+static LiveSlice *deque_steal(Deque *deque) {
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom) return NULL;
+    LiveSlice *slice = atomic_load_explicit(&deque->items[top & (LIVE_DEQUE_SIZE - 1)],
+                                            memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;
+    }
+    return slice;
+}
+
+/**
+ * deque_size
+ * Slices pushed and not yet stolen.
+ */
+static long deque_size(Deque *deque) {
+    return atomic_load(&deque->bottom) - atomic_load(&deque->top);
+}
+
+/**
+ * worker_main
+ * Run slices from the worker's own deque, stealing from the others when it
+ * is empty, until the dispatcher says stop.
+ */
+static void *worker_main(void *arg) {
+    Worker *self = arg;
+    while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+        LiveSlice *slice = NULL;
+        for (int i = 0; i < num_workers && slice == NULL; i++) {
+            slice = deque_steal(&deques[(self->id + i) % num_workers]);
+        }
+        if (slice == NULL) {
+            struct timespec pause = {0, 20000};
+            nanosleep(&pause, NULL);
+            continue;
+        }
+        slice->worker = self->id;
+        slice->start_ns = now_ns();
+        spin((long)(slice->units * (double)live_unit_us * spins_per_us));
+        slice->end_ns = now_ns();
+
+        LiveSlice *head = atomic_load(&finished);
+        do {
+            slice->next = head;
+        } while (!atomic_compare_exchange_weak(&finished, &head, slice));
+    }
+    return NULL;
+}
+
+/**
+ * by_arrival
+ * qsort comparator: arrival time, then input order.
+ */
+static int by_arrival(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    if (metrics.arrival[x] != metrics.arrival[y]) {
+        return metrics.arrival[x] < metrics.arrival[y] ? -1 : 1;
+    }
+    return x - y;
+}
+
+/**
+ * live_run
+ * Execute the workload on real threads under a policy. Arrivals are
+ * released at t0 + arrival * live_unit_us, slices are tick() units long
+ * and a preempted (unfinished) task goes back to the policy. Preemption
+ * happens only at slice ends, since a running spin cannot be interrupted.
+ * @param policy   Policy deciding which task runs and for how long
+ * @param workers  Number of worker threads
+ */
+void live_run(Policy *policy, int workers) {
+    int n = metrics.count;
+    calibrate();
+
+    // keep the simulated metrics, then give the policy a clean slate
+    sim_start = realloc(sim_start, (n ? n : 1) * sizeof(int));
+    sim_finish = realloc(sim_finish, (n ? n : 1) * sizeof(int));
+    memcpy(sim_start, metrics.start, n * sizeof(int));
+    memcpy(sim_finish, metrics.finish, n * sizeof(int));
+    metrics_reset();
+    live_arrival = realloc(live_arrival, (n ? n : 1) * sizeof(long long));
+    live_start = realloc(live_start, (n ? n : 1) * sizeof(long long));
+    live_finish = realloc(live_finish, (n ? n : 1) * sizeof(long long));
+
+    // arrival order and one task record plus slice per task
+    int *order = malloc((n ? n : 1) * sizeof(int));
+    for (int i = 0; i < n; i++) order[i] = i;
+    qsort(order, n, sizeof(int), by_arrival);
+    Task *tasks = malloc((n ? n : 1) * sizeof(Task));
+    LiveSlice *slices = malloc((n ? n : 1) * sizeof(LiveSlice));
+
+    rank_names();
+    policy->init(1);
+    num_workers = workers;
+    live_workers = workers;
+    live_steals = 0;
+    deques = calloc(workers, sizeof(Deque));
+    Worker *pool = malloc(workers * sizeof(Worker));
+    atomic_store(&stop, 0);
+    atomic_store(&finished, NULL);
+    int started = 0;
+    for (int w = 0; w < workers; w++) {
+        pool[w].id = w;
+        int err = pthread_create(&pool[w].thread, NULL, worker_main, &pool[w]);
+        if (err != 0) {
+            fprintf(stderr, "live: worker %d: %s\n", w, strerror(err));
+            break;
+        }
+        started++;
+    }
+    if (started == 0) exit(1);
+    // the started workers still steal from every deque; only fill theirs
+    workers = started;
+    live_workers = started;
+
+    long long t0 = now_ns();
+    long long unit_ns = live_unit_us * 1000LL;
+    int arrived = 0, done = 0, ready = 0;
+    while (done < n) {
+        long long now = now_ns() - t0;
+        int progress = 0;
+        sim_time = (int)(now / unit_ns);
+
+        // release tasks whose arrival time has passed
+        while (arrived < n && metrics.arrival[order[arrived]] * unit_ns <= now) {
+            int tid = order[arrived++];
+            Task *task = &tasks[tid];
+            task->name = metrics.name[tid];
+            task->tid = tid;
+            task->priority = metrics.priority[tid];
+            task->burst = metrics.burst[tid];
+            task->rank = name_rank(task->name);
+            task->cpu = -1;
+            live_arrival[tid] = metrics.arrival[tid] * unit_ns;
+            live_start[tid] = -1;
+            policy->enqueue(0, task);
+            ready++;
+            progress = 1;
+        }
+
+        // account for finished slices
+        LiveSlice *slice = atomic_exchange(&finished, NULL);
+        while (slice != NULL) {
+            LiveSlice *next = slice->next;
+            Task *task = slice->task;
+            if (task->cpu >= 0 && task->cpu != slice->worker) live_steals++;
+            task->cpu = slice->worker;
+            task->burst -= slice->units;
+            if (live_start[task->tid] < 0) live_start[task->tid] = slice->start_ns - t0;
+            if (task->burst == 0) {
+                live_finish[task->tid] = slice->end_ns - t0;
+                policy->complete(task);
+                done++;
+            } else {
+                policy->enqueue(0, task);
+                ready++;
+            }
+            slice = next;
+            progress = 1;
+        }
+
+        // keep every worker's deque topped up with the policy's picks
+        while (ready > 0) {
+            int target = 0;
+            for (int w = 1; w < workers; w++) {
+                if (deque_size(&deques[w]) < deque_size(&deques[target])) target = w;
+            }
+            if (deque_size(&deques[target]) >= LIVE_DEPTH) break;
+            Task *task = policy->pick(0);
+            if (task == NULL) break;
+            ready--;
+            if (metrics.start[task->tid] < 0) {
+                // the policy only needs to know the task has run
+                metrics.start[task->tid] = (int)(now / unit_ns);
+            }
+            LiveSlice *next_slice = &slices[task->tid];
+            next_slice->task = task;
+            next_slice->units = policy->tick(task);
+            next_slice->start_ns = 0;
+            deque_push(&deques[target], next_slice);
+            progress = 1;
+        }
+
+        if (!progress) {
+            struct timespec pause = {0, 20000};
+            nanosleep(&pause, NULL);
+        }
+    }
+
+    atomic_store(&stop, 1);
+    for (int w = 0; w < workers; w++) {
+        pthread_join(pool[w].thread, NULL);
+    }
+
+    free(pool);
+    free(deques);
+    free(slices);
+    free(tasks);
+    free(order);
+}
+
+/**
+ * live_report
+ * Print measured wall-clock TAT/WT/RT, in time units, under the simulated
+ * ones when the table is on, plus the averages of both and how often a
+ * slice changed worker.
+ * @param table  Nonzero to print the per-task table
+ */
+void live_report(int table) {
+    int n = metrics.count;
+    double unit_ns = live_unit_us * 1000.0;
+    double sim_tat = 0, sim_wt = 0, sim_rt = 0, tat = 0, wt = 0, rt = 0;
+
+    printf("\nLive run: %d worker%s, 1 unit = %d us, %ld slice%s changed worker\n",
+           live_workers, live_workers == 1 ? "" : "s", live_unit_us,
+           live_steals, live_steals == 1 ? "" : "s");
+    for (int i = 0; i < n; i++) {
+        sim_tat += sim_finish[i] - metrics.arrival[i];
+        sim_wt += sim_finish[i] - metrics.arrival[i] - metrics.burst[i];
+        sim_rt += sim_start[i] - metrics.arrival[i];
+        tat += (live_finish[i] - live_arrival[i]) / unit_ns;
+        wt += (live_finish[i] - live_arrival[i]) / unit_ns - metrics.burst[i];
+        rt += (live_start[i] - live_arrival[i]) / unit_ns;
+    }
+
+    if (table) {
+        printf("...|");
+        for (int i = 0; i < n; i++) {
+            printf(" %-6s |", metrics.name[i]);
+        }
+        printf("\n");
+
+        printf("TAT|");
+        for (int i = 0; i < n; i++) {
+            printf(" %-6d |", sim_finish[i] - metrics.arrival[i]);
+        }
+        printf("\n");
+        printf("  ~|");
+        for (int i = 0; i < n; i++) {
+            printf(" %-6.1f |", (live_finish[i] - live_arrival[i]) / unit_ns);
+        }
+        printf("\n");
+
+        printf("WT |");
+        for (int i = 0; i < n; i++) {
+            printf(" %-6d |", sim_finish[i] - metrics.arrival[i] - metrics.burst[i]);
+        }
+        printf("\n");
+        printf("  ~|");
+        for (int i = 0; i < n; i++) {
+            printf(" %-6.1f |", (live_finish[i] - live_arrival[i]) / unit_ns - metrics.burst[i]);
+        }
+        printf("\n");
+
+        printf("RT |");
+        for (int i = 0; i < n; i++) {
+            printf(" %-6d |", sim_start[i] - metrics.arrival[i]);
+        }
+        printf("\n");
+        printf("  ~|");
+        for (int i = 0; i < n; i++) {
+            printf(" %-6.1f |", (live_start[i] - live_arrival[i]) / unit_ns);
+        }
+        printf("\n");
+    }
+
+    if (n > 0) {
+        printf("Average TAT: %.2f simulated, %.2f live\n", sim_tat / n, tat / n);
+        printf("Average WT:  %.2f simulated, %.2f live\n", sim_wt / n, wt / n);
+        printf("Average RT:  %.2f simulated, %.2f live\n", sim_rt / n, rt / n);
+    }
+}
@@ -0,0 +1,33 @@
+/**
+ * live.h
+ * Live execution mode: every slice the policy picks becomes a calibrated
+ * CPU spin on a pthread worker, and TAT/WT/RT are measured on the wall
+ * clock next to the simulated values.
+ */
+
+#ifndef LIVE_H
+#define LIVE_H
+
+#include "schedulers.h"
+
+// default wall-clock length of one time unit, in microseconds
+#define LIVE_UNIT_US 1000
+
+// slices waiting in one worker's deque, on top of the one it runs
+#define LIVE_DEPTH 1
+
+// slots per deque; must be a power of two above LIVE_DEPTH
+#define LIVE_DEQUE_SIZE 16
+
+// microseconds per simulated time unit in live mode
+extern int live_unit_us;
+
+// run the workload under a policy on workers threads; call after
+// schedule_with() has produced the simulated metrics to compare against
+void live_run(Policy *policy, int workers);
+
+// print measured TAT/WT/RT beside the simulated ones; the per-task table
+// only when table is nonzero
+void live_report(int table);
+
+#endif
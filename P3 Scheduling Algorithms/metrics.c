@@ -0,0 +1,174 @@
+/**
+ * metrics.c
+ * Growable struct-of-arrays metrics and interned task names.
+ * Names live in large shared blocks and are deduplicated through an
+ * open-addressing hash table, so a workload of millions of tasks costs a
+ * handful of allocations instead of one strdup per task.
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "metrics.h"
+
+_Thread_local Metrics metrics = {0};
+
+// interned names: open-addressing table of pointers into name blocks
+static char **name_table = NULL;
+static size_t name_table_size = 0;
+static size_t name_table_used = 0;
+static char *name_block = NULL;
+static size_t name_block_left = 0;
+static bool names_ranked = true;
+
+/**
+ * hash_name
+ * FNV-1a hash of a name.
+ * @param name  Name bytes
+ * @param len   Number of bytes
+ */
+static size_t hash_name(const char *name, size_t len) {
+    size_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (unsigned char)name[i]) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * grow_name_table
+ * Double the hash table and rehash every interned name.
+ */
+static void grow_name_table() {
+    size_t old_size = name_table_size;
+    char **old_table = name_table;
+    name_table_size = old_size ? old_size * 2 : 1024;
+    name_table = calloc(name_table_size, sizeof(char *));
+    for (size_t i = 0; i < old_size; i++) {
+        if (old_table[i] == NULL) continue;
+        size_t slot = hash_name(old_table[i], strlen(old_table[i])) & (name_table_size - 1);
+        while (name_table[slot] != NULL) {
+            slot = (slot + 1) & (name_table_size - 1);
+        }
+        name_table[slot] = old_table[i];
+    }
+    free(old_table);
+}
+
+/**
+ * intern
+ * Return the shared copy of a name, copying it into name storage the
+ * first time it is seen. Room for its rank is kept in front of it; the
+ * rank is -1 until the next rank_names().
+ * @param name  Name bytes, need not be NUL-terminated
+ * @param len   Number of bytes
+ * @return NUL-terminated interned name
+ */
+char *intern(const char *name, size_t len) {
+    if (2 * (name_table_used + 1) > name_table_size) {
+        grow_name_table();
+    }
+    size_t slot = hash_name(name, len) & (name_table_size - 1);
+    while (name_table[slot] != NULL) {
+        char *entry = name_table[slot];
+        if (strncmp(entry, name, len) == 0 && entry[len] == '\0') {
+            return entry;
+        }
+        slot = (slot + 1) & (name_table_size - 1);
+    }
+
+    // rank + name + NUL, rounded up so the next rank stays aligned
+    size_t need = (sizeof(int) + len + 1 + sizeof(int) - 1) & ~(sizeof(int) - 1);
+    if (need > name_block_left) {
+        size_t size = need > NAME_BLOCK ? need : NAME_BLOCK;
+        name_block = malloc(size);
+        name_block_left = size;
+    }
+    char *copy = name_block + sizeof(int);
+    memcpy(copy, name, len);
+    copy[len] = '\0';
+    name_rank(copy) = -1;
+    name_block += need;
+    name_block_left -= need;
+
+    name_table[slot] = copy;
+    name_table_used++;
+    names_ranked = false;
+    return copy;
+}
+
+/**
+ * compare_names
+ * qsort comparator for an array of names.
+ */
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char **)a, *(char **)b);
+}
+
+/**
+ * rank_names
+ * Sort the distinct interned names and store each one's position in front
+ * of it. Only runs when a name was interned since the last call.
+ */
+void rank_names() {
+    if (names_ranked) return;
+    char **sorted = malloc((name_table_used ? name_table_used : 1) * sizeof(char *));
+    size_t n = 0;
+    for (size_t i = 0; i < name_table_size; i++) {
+        if (name_table[i] != NULL) sorted[n++] = name_table[i];
+    }
+    qsort(sorted, n, sizeof(char *), compare_names);
+    for (size_t i = 0; i < n; i++) {
+        name_rank(sorted[i]) = (int)i;
+    }
+    free(sorted);
+    names_ranked = true;
+}
+
+/**
+ * grow_column
+ * Resize one metric column to the current capacity.
+ * @param column  Column to resize
+ */
+static void grow_column(int **column) {
+    *column = realloc(*column, metrics.capacity * sizeof(int));
+}
+
+/**
+ * metrics_add
+ * Append a task to the workload, growing every column when full.
+ * @param name      Task name bytes, interned here
+ * @param len       Number of name bytes
+ * @param priority  Task priority
+ * @param burst     CPU burst length
+ * @param arrival   Arrival time
+ * @return The new task's id
+ */
+int metrics_add(const char *name, size_t len, int priority, int burst, int arrival) {
+    if (metrics.count == metrics.capacity) {
+        metrics.capacity = metrics.capacity ? metrics.capacity * 2 : METRICS_INITIAL;
+        metrics.name = realloc(metrics.name, metrics.capacity * sizeof(char *));
+        grow_column(&metrics.priority);
+        grow_column(&metrics.burst);
+        grow_column(&metrics.arrival);
+        grow_column(&metrics.start);
+        grow_column(&metrics.finish);
+    }
+    int tid = metrics.count++;
+    metrics.name[tid] = intern(name, len);
+    metrics.priority[tid] = priority;
+    metrics.burst[tid] = burst;
+    metrics.arrival[tid] = arrival;
+    metrics.start[tid] = -1;
+    metrics.finish[tid] = -1;
+    return tid;
+}
+
+/**
+ * metrics_reset
+ * Mark every task as not yet started or finished.
+ */
+void metrics_reset() {
+    memset(metrics.start, 0xff, metrics.count * sizeof(int));
+    memset(metrics.finish, 0xff, metrics.count * sizeof(int));
+}
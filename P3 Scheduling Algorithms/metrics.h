@@ -0,0 +1,64 @@
+/**
+ * metrics.h
+ * Struct-of-arrays storage for the parsed workload and per-task metrics,
+ * plus the table of interned task names. Each interned name is preceded by
+ * its rank, so ties can be broken by name with one integer compare.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <string.h>
+
+#include "task.h"
+
+// first capacity of the metric arrays; they double as tasks are added
+#define METRICS_INITIAL 1024
+
+// bytes per block of interned name storage
+#define NAME_BLOCK (1 << 20)
+
+// one column per field, indexed by task id
+typedef struct metrics {
+    int count;      // tasks in the workload
+    int capacity;   // slots allocated in each column
+    char **name;    // interned task name
+    int *priority;  // task priority
+    int *burst;     // original CPU burst
+    int *arrival;   // arrival time
+    int *start;     // first dispatch in the last schedule, -1 if never run
+    int *finish;    // completion in the last schedule, -1 if unfinished
+} Metrics;
+
+// the loaded workload; a sweep worker shares its columns except start
+// and finish, which every thread keeps for itself
+extern _Thread_local Metrics metrics;
+
+// return the one shared copy of a name
+char *intern(const char *name, size_t len);
+
+// number every interned name in strcmp order, if any name is new
+void rank_names();
+
+// position of an interned name in strcmp order, -1 if interned since the
+// last rank_names()
+#define name_rank(name) (((int *)(name))[-1])
+
+/**
+ * compare_task_names
+ * strcmp order of two tasks' names: one integer compare when both are
+ * ranked, strcmp when either was streamed in after rank_names().
+ */
+static inline int compare_task_names(const Task *a, const Task *b) {
+    if (a->rank >= 0 && b->rank >= 0) return a->rank - b->rank;
+    return strcmp(a->name, b->name);
+}
+
+// append a task to the workload and return its id
+int metrics_add(const char *name, size_t len, int priority, int burst, int arrival);
+
+// clear start and finish times before another schedule
+void metrics_reset();
+
+#endif
@@ -0,0 +1,149 @@
+/**
+ * parser.c
+ * Zero-copy task file parser over a read-only mapping of the file.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "parser.h"
+
+/**
+ * parser_open
+ * Map a task file for reading.
+ * @param parser  Parser to set up
+ * @param path    Task file
+ * @return 0 on success, -1 if the file cannot be opened or mapped
+ */
+int parser_open(Parser *parser, const char *path) {
+    memset(parser, 0, sizeof(*parser));
+    parser->path = path;
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    parser->size = st.st_size;
+    if (parser->size > 0) {
+        void *data = mmap(NULL, parser->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            perror(path);
+            close(fd);
+            return -1;
+        }
+        madvise(data, parser->size, MADV_SEQUENTIAL);
+        parser->data = data;
+    } else {
+        parser->data = "";
+    }
+    close(fd);
+    parser->cursor = parser->data;
+    parser->end = parser->data + parser->size;
+    return 0;
+}
+
+static int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/**
+ * parse_int
+ * Read an optionally signed decimal integer surrounded by blanks, ending
+ * at a comma or at the end of the line.
+ * @param p      Position in the line; moved past the comma, if any
+ * @param end    End of the line
+ * @param value  Receives the number
+ * @return 0 on success, -1 if the field is empty, not a number or too large
+ */
+static int parse_int(const char **p, const char *end, int *value) {
+    const char *s = *p;
+    while (s < end && is_space(*s)) s++;
+    int negative = 0;
+    if (s < end && (*s == '-' || *s == '+')) {
+        negative = *s == '-';
+        s++;
+    }
+    if (s == end || *s < '0' || *s > '9') return -1;
+    long long n = 0;
+    while (s < end && *s >= '0' && *s <= '9') {
+        n = n * 10 + (*s++ - '0');
+        if (n > INT_MAX) return -1;
+    }
+    while (s < end && is_space(*s)) s++;
+    if (s < end && *s != ',') return -1;
+    *value = negative ? (int)-n : (int)n;
+    *p = s < end ? s + 1 : s;
+    return 0;
+}
+
+/**
+ * malformed
+ * Report a bad line.
+ * @return -1, for the caller to pass on
+ */
+static int malformed(Parser *parser, const char *what) {
+    fprintf(stderr, "%s:%d: %s\n", parser->path, parser->line, what);
+    return -1;
+}
+
+/**
+ * parser_next
+ * Read the next non-blank line as a task.
+ * @param parser  Open parser
+ * @param task    Receives the fields; the name is a slice of the file
+ * @return 1 if a task was read, 0 at end of file, -1 on a malformed line
+ */
+int parser_next(Parser *parser, TaskLine *task) {
+    while (parser->cursor < parser->end) {
+        const char *start = parser->cursor;
+        const char *newline = memchr(start, '\n', parser->end - start);
+        const char *end = newline ? newline : parser->end;
+        parser->cursor = newline ? newline + 1 : parser->end;
+        parser->line++;
+
+        const char *p = start;
+        while (p < end && is_space(*p)) p++;
+        if (p == end) continue;
+
+        const char *comma = memchr(start, ',', end - start);
+        if (comma == NULL) return malformed(parser, "expected name, priority, burst[, arrival]");
+        task->name = start;
+        task->name_length = comma - start;
+        if (task->name_length == 0) return malformed(parser, "missing task name");
+        p = comma + 1;
+
+        if (parse_int(&p, end, &task->priority) < 0) return malformed(parser, "bad priority");
+        if (p == end) return malformed(parser, "missing burst");
+        if (parse_int(&p, end, &task->burst) < 0) return malformed(parser, "bad burst");
+        if (task->burst < 0) return malformed(parser, "negative burst");
+        task->arrival = 0;
+        if (p < end) {
+            if (parse_int(&p, end, &task->arrival) < 0) return malformed(parser, "bad arrival");
+            if (task->arrival < 0) return malformed(parser, "negative arrival");
+            if (p < end || p[-1] == ',') return malformed(parser, "too many fields");
+        } else if (p[-1] == ',') {
+            return malformed(parser, "missing arrival");
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * parser_close
+ * Unmap the task file.
+ */
+void parser_close(Parser *parser) {
+    if (parser->size > 0) {
+        munmap((void *)parser->data, parser->size);
+    }
+    parser->data = NULL;
+    parser->size = 0;
+}
@@ -0,0 +1,45 @@
+/**
+ * parser.h
+ * Zero-copy task file parser. The file is mapped read-only and each line
+ * is read in place; task names are handed out as slices of the mapping.
+ *
+ *  [name], [priority], [CPU burst][, arrival]
+ *
+ * Blank lines are skipped. Any other line that does not fit the format is
+ * reported with its line number.
+ */
+
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <stddef.h>
+
+typedef struct parser {
+    const char *path;       // file name, for messages
+    const char *data;       // start of the mapping
+    const char *cursor;     // start of the next line
+    const char *end;        // end of the mapping
+    size_t size;            // bytes mapped
+    int line;               // number of the last line read
+} Parser;
+
+// one parsed task line; name points into the mapping
+typedef struct task_line {
+    const char *name;
+    size_t name_length;
+    int priority;
+    int burst;
+    int arrival;
+} TaskLine;
+
+// map a task file; returns 0, or -1 after printing why it failed
+int parser_open(Parser *parser, const char *path);
+
+// read the next task: 1 if one was read, 0 at end of file, -1 after
+// printing a message naming the malformed line
+int parser_next(Parser *parser, TaskLine *task);
+
+// unmap the file
+void parser_close(Parser *parser);
+
+#endif
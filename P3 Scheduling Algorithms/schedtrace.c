@@ -0,0 +1,243 @@
+/**
+ * schedtrace.c
+ * Turn a binary trace from sched --trace=file back into readable output:
+ *
+ *  schedtrace [--text|--gantt|--csv] tracefile
+ *
+ * --text (default) reproduces the simulator's per-slice lines, --gantt
+ * prints each CPU's timeline with consecutive slices of a task merged,
+ * and --csv prints one row per record.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "trace.h"
+
+// one policy's run inside the trace file
+typedef struct run {
+    const TraceHeader *header;
+    const TraceRecord *records;
+    long count;                 // records before TRACE_END
+    int tasks;
+    const TraceTask **task;     // task table entries, by tid
+    const char **name;          // their names, not terminated
+} Run;
+
+/**
+ * load_run
+ * Index the run starting at data[offset].
+ * @return Offset just past the run, or -1 if the file is malformed
+ */
+static long load_run(const char *data, long size, long offset, Run *run) {
+    if (offset + (long)sizeof(TraceHeader) > size) return -1;
+    run->header = (const TraceHeader *)(data + offset);
+    if (memcmp(run->header->magic, TRACE_MAGIC, sizeof(run->header->magic)) != 0 ||
+        run->header->version != TRACE_VERSION) {
+        return -1;
+    }
+    offset += sizeof(TraceHeader);
+    run->records = (const TraceRecord *)(data + offset);
+    run->count = 0;
+    while (1) {
+        if (offset + (long)sizeof(TraceRecord) > size) return -1;
+        const TraceRecord *record = (const TraceRecord *)(data + offset);
+        offset += sizeof(TraceRecord);
+        if (record->type == TRACE_END) {
+            run->tasks = record->tid;
+            break;
+        }
+        run->count++;
+    }
+    run->task = malloc((run->tasks ? run->tasks : 1) * sizeof(TraceTask *));
+    run->name = malloc((run->tasks ? run->tasks : 1) * sizeof(char *));
+    for (int i = 0; i < run->tasks; i++) {
+        if (offset + (long)sizeof(TraceTask) > size) return -1;
+        run->task[i] = (const TraceTask *)(data + offset);
+        offset += sizeof(TraceTask);
+        int padded = TRACE_NAME_PAD(run->task[i]->name_length);
+        if (run->task[i]->name_length < 0 || offset + padded > size) return -1;
+        run->name[i] = data + offset;
+        offset += padded;
+    }
+    return offset;
+}
+
+/**
+ * valid_tid
+ * Whether a record refers to a task of the run's table.
+ */
+static int valid_tid(const Run *run, const TraceRecord *record) {
+    return record->tid >= 0 && record->tid < run->tasks;
+}
+
+/**
+ * print_text
+ * The per-slice lines the simulator prints without --trace.
+ */
+static void print_text(const Run *run) {
+    int cpus = run->header->cpus;
+    for (long i = 0; i < run->count; i++) {
+        const TraceRecord *r = &run->records[i];
+        if (r->type != TRACE_IDLE && !valid_tid(run, r)) continue;
+        switch (r->type) {
+        case TRACE_RUN:
+            printf("Running task = [%.*s] [%d] [%d] for %d units",
+                   run->task[r->tid]->name_length, run->name[r->tid],
+                   run->task[r->tid]->priority, r->arg, r->length);
+            if (cpus > 1) printf(" on CPU %d", r->cpu);
+            printf(".\n\tTime is now: %d\n", r->start + r->length);
+            break;
+        case TRACE_IDLE:
+            if (cpus > 1) {
+                printf("CPU %d idle for %d units.\n", r->cpu, r->length);
+            } else {
+                printf("CPU idle for %d units.\n", r->length);
+            }
+            printf("\tTime is now: %d\n", r->start + r->length);
+            break;
+        case TRACE_MIGRATE:
+            printf("Migrating task = [%.*s] from CPU %d to CPU %d.\n",
+                   run->task[r->tid]->name_length, run->name[r->tid], r->arg, r->cpu);
+            break;
+        }
+    }
+}
+
+/**
+ * print_gantt
+ * Each CPU's timeline, one line per stretch of a single task or of idle
+ * time, with back-to-back slices of the same task merged, followed by the
+ * CPU's busy and idle totals.
+ */
+static void print_gantt(const Run *run) {
+    for (int cpu = 0; cpu < run->header->cpus; cpu++) {
+        long busy = 0, idle = 0, slices = 0;
+        int tid = -2, start = 0, end = 0;
+        printf("CPU %d:\n", cpu);
+        for (long i = 0; i <= run->count; i++) {
+            const TraceRecord *r = i < run->count ? &run->records[i] : NULL;
+            if (r != NULL && (r->cpu != cpu || r->type == TRACE_MIGRATE)) continue;
+            if (r != NULL && r->type == TRACE_RUN && !valid_tid(run, r)) continue;
+            int next = r == NULL ? -3 : r->type == TRACE_IDLE ? -1 : r->tid;
+            if (r != NULL && next == tid && r->start == end) {
+                end = r->start + r->length;
+            } else {
+                if (tid == -1) {
+                    printf("  %8d-%-8d  (idle)\n", start, end);
+                } else if (tid >= 0) {
+                    printf("  %8d-%-8d  %.*s\n", start, end,
+                           run->task[tid]->name_length, run->name[tid]);
+                }
+                if (r == NULL) break;
+                tid = next;
+                start = r->start;
+                end = r->start + r->length;
+            }
+            if (r->type == TRACE_IDLE) {
+                idle += r->length;
+            } else {
+                busy += r->length;
+                slices++;
+            }
+        }
+        printf("  busy %ld, idle %ld, slices %ld\n", busy, idle, slices);
+    }
+}
+
+/**
+ * print_csv
+ * One row per record.
+ */
+static void print_csv(const Run *run) {
+    static const char *types[] = {"run", "idle", "migrate"};
+    printf("policy,type,tid,name,cpu,start,length,arg\n");
+    for (long i = 0; i < run->count; i++) {
+        const TraceRecord *r = &run->records[i];
+        if (r->type > TRACE_MIGRATE) continue;
+        printf("%s,%s,%d,", run->header->policy, types[r->type], r->tid);
+        if (valid_tid(run, r)) {
+            printf("%.*s", run->task[r->tid]->name_length, run->name[r->tid]);
+        }
+        printf(",%d,%d,%d,%d\n", r->cpu, r->start, r->length, r->arg);
+    }
+}
+
+/**
+ * usage
+ * Print the command line syntax and exit.
+ */
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [--text|--gantt|--csv] tracefile\n", prog);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    void (*print)(const Run *) = print_text;
+    char *file = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--text") == 0) {
+            print = print_text;
+        } else if (strcmp(argv[i], "--gantt") == 0) {
+            print = print_gantt;
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            print = print_csv;
+        } else if (argv[i][0] == '-' || file != NULL) {
+            usage(argv[0]);
+        } else {
+            file = argv[i];
+        }
+    }
+    if (file == NULL) usage(argv[0]);
+
+    int fd = open(file, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(file);
+        return 1;
+    }
+    long size = st.st_size;
+    const char *data = "";
+    if (size > 0) {
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            perror(file);
+            return 1;
+        }
+    }
+    close(fd);
+
+    // index every run first so the policy headers match the simulator's
+    int runs = 0, capacity = 4;
+    Run *run = malloc(capacity * sizeof(Run));
+    long offset = 0;
+    while (offset < size) {
+        if (runs == capacity) {
+            capacity *= 2;
+            run = realloc(run, capacity * sizeof(Run));
+        }
+        offset = load_run(data, size, offset, &run[runs]);
+        if (offset < 0) {
+            fprintf(stderr, "%s: not a schedule trace or truncated\n", file);
+            return 1;
+        }
+        runs++;
+    }
+
+    for (int i = 0; i < runs; i++) {
+        if (runs > 1 && print != print_csv) {
+            printf("%s==> %s <==\n", i > 0 ? "\n" : "", run[i].header->policy);
+        }
+        print(&run[i]);
+        free(run[i].task);
+        free(run[i].name);
+    }
+    free(run);
+    return 0;
+}
@@ -1,7 +1,7 @@
 /**
  * schedule_fcfs.c
  * Implements First-Come, First-Served scheduling.
- * add(): enqueue tasks in arrival order; schedule(): execute in queue order.
+ * enqueue(): append in arrival order; pick(): take the head; tick(): whole burst.
  */
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,89 +10,48 @@
 #include "task.h"
 #include "list.h"
 #include "schedulers.h"
-#include "cpu.h"
+#include "metrics.h"
 
-extern int task_count;
-extern char *metric_names[];
-extern int metric_arrival[];
-extern int metric_start[];
-extern int metric_finish[];
-extern int metric_burst[];
+static _Thread_local Queue *ready = NULL;     // one FIFO per CPU
+static _Thread_local Task **next = NULL;      // FIFO successor of each task id
+static _Thread_local int slots = 0;           // task ids next has room for
 
-struct node *g_head = NULL;
+// grow next to cover every task id; the workload grows while streaming
+static void reserve() {
+    if (slots < metrics.capacity) {
+        slots = metrics.capacity;
+        next = realloc(next, slots * sizeof(Task *));
+    }
+}
 
-/**
- * add
- * Create a Task and enqueue it for FCFS execution.
- * Initializes timing metrics for later reporting.
- */
-void add(char *name, int priority, int burst) {
-    Task *task = malloc(sizeof(Task));
-    task->name = strdup(name);
-    task->priority = priority;
-    task->burst = burst;
-    task->original_burst = burst;
-    task->arrival_time = 0;
-    task->start_time = -1;
-    task->finish_time = -1;
-    task->tid = task_count;
-    metric_names[task_count] = task->name;
-    metric_arrival[task_count] = 0;
-    metric_burst[task_count] = burst;
-    metric_start[task_count] = -1;
-    metric_finish[task_count] = -1;
-    task_count++;
-    // Append to end of the list for FCFS order
-    struct node *new_node = malloc(sizeof(struct node));
-    new_node->task = task;
-    new_node->next = NULL;
-    if (g_head == NULL) {
-        g_head = new_node;
-    } else {
-        struct node *cur = g_head;
-        while (cur->next != NULL) {
-            cur = cur->next;
-        }
-        cur->next = new_node;
+static void fcfs_init(int cpus) {
+    ready = realloc(ready, cpus * sizeof(Queue));
+    for (int c = 0; c < cpus; c++) {
+        queue_init(&ready[c]);
     }
+    reserve();
+}
+
+// Append to end of the list for FCFS order
+static void fcfs_enqueue(int cpu, Task *task) {
+    if (task->tid >= slots) reserve();
+    queue_push(&ready[cpu], task, next);
 }
 
 // FCFS: always run the task at the head of the list
-Task *pickNextTask() {
-    if (g_head == NULL) {
-        return NULL;
-    }
-    Task *task = g_head->task;
-    // remove the head node
-    struct node *old_head = g_head;
-    g_head = g_head->next;
-    free(old_head);
-    return task;
+static Task *fcfs_pick(int cpu) {
+    return queue_pop(&ready[cpu], next);
 }
 
-/**
- * schedule
- * Execute the FCFS scheduling loop until all tasks complete.
- * Records each task's start and finish times for metrics.
- */
-void schedule() {
-    Task *task;
-    int currentTime = 0;
-    while ((task = pickNextTask()) != NULL) {
-        if (metric_start[task->tid] < 0) {
-            metric_start[task->tid] = currentTime;
-        }
-        run(task, task->burst);
-        currentTime += task->burst;
-        if (task->burst == 0) {
-            metric_finish[task->tid] = currentTime;
-        }
-        else if (task->burst > 0) {
-            // FCFS always runs to completion
-            metric_finish[task->tid] = currentTime;
-        }
-        printf("\tTime is now: %d\n", currentTime);
-        // free(task->name);
-        free(task);
-    }
-}
\ No newline at end of file
+// FCFS always runs to completion
+static int fcfs_tick(Task *task) {
+    return task->burst;
+}
+
+static void fcfs_complete(Task *task) {
+    (void)task;
+}
+
+Policy fcfs_policy = {
+    "fcfs", fcfs_init, fcfs_enqueue, fcfs_pick, fcfs_tick, fcfs_complete, NULL
+};
@@ -0,0 +1,189 @@
+/**
+ * schedule_mlfq.c
+ * Implements a multilevel feedback queue.
+ * enqueue(): a new task joins the top level; a returning task is charged
+ * for the units it ran and drops a level once it has used up that level's
+ * quantum. pick(): the head of the highest non-empty level. tick(): what
+ * is left of the task's quantum at its level, or its burst if shorter.
+ * A new arrival preempts a task running on a lower level. Every
+ * mlfq_boost units all tasks return to the top level, and a task that has
+ * waited mlfq_age units in its queue moves up one level, so long jobs at
+ * the bottom cannot starve.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "task.h"
+#include "list.h"
+#include "schedulers.h"
+#include "metrics.h"
+
+int mlfq_levels = MLFQ_LEVELS;
+int mlfq_quanta[MLFQ_MAX_LEVELS];
+int mlfq_boost = MLFQ_BOOST;
+int mlfq_age = MLFQ_AGE;
+
+// per-task MLFQ bookkeeping, indexed by task id
+typedef struct mlfq_state {
+    int level;          // queue level, 0 is the top
+    int used;           // units run at this level
+    int epoch;          // boost epoch the level belongs to, 0 if never queued
+    int ready_since;    // when the task joined its queue
+    int picked_burst;   // remaining burst when last picked
+} MlfqState;
+
+typedef struct mlfq_queue {
+    Queue levels[MLFQ_MAX_LEVELS];
+} MlfqQueue;
+
+static _Thread_local MlfqQueue *queues = NULL;   // one per CPU
+static _Thread_local int num_queues = 0;
+static _Thread_local Task **next = NULL;         // FIFO successor of each task id
+static _Thread_local MlfqState *state = NULL;
+static _Thread_local int slots = 0;              // task ids next and state have room for
+static _Thread_local int epoch = 1;              // bumped by every boost
+static _Thread_local int next_boost = 0;
+
+// grow next and state to cover every task id; the workload grows while streaming
+static void reserve() {
+    if (slots < metrics.capacity) {
+        next = realloc(next, metrics.capacity * sizeof(Task *));
+        state = realloc(state, metrics.capacity * sizeof(MlfqState));
+        memset(state + slots, 0, (metrics.capacity - slots) * sizeof(MlfqState));
+        slots = metrics.capacity;
+    }
+}
+
+// quantum of a level: --mlfq-quanta if given, else the quantum doubled per level
+static int quantumOf(int level) {
+    if (mlfq_quanta[level] > 0) return mlfq_quanta[level];
+    return quantum << level;
+}
+
+// the task's level, or the top if a boost happened since it was queued
+static MlfqState *stateOf(Task *task) {
+    MlfqState *s = &state[task->tid];
+    if (s->epoch != epoch) {
+        s->level = 0;
+        s->used = 0;
+        s->epoch = epoch;
+    }
+    return s;
+}
+
+// move every queued task of every CPU to the top level, highest level first
+static void boost() {
+    for (int c = 0; c < num_queues; c++) {
+        Queue *top = &queues[c].levels[0];
+        for (int l = 1; l < mlfq_levels; l++) {
+            Queue *level = &queues[c].levels[l];
+            if (level->head == NULL) continue;
+            if (top->head == NULL) {
+                top->head = level->head;
+            } else {
+                next[top->tail->tid] = level->head;
+            }
+            top->tail = level->tail;
+            queue_init(level);
+        }
+    }
+    epoch++;
+}
+
+// move tasks that waited mlfq_age units up a level; each FIFO is in
+// ready_since order, so only heads need checking
+static void age(MlfqQueue *q) {
+    for (int l = 1; l < mlfq_levels; l++) {
+        while (q->levels[l].head != NULL &&
+               sim_time - state[q->levels[l].head->tid].ready_since >= mlfq_age) {
+            Task *task = queue_pop(&q->levels[l], next);
+            MlfqState *s = stateOf(task);
+            s->level = l - 1;
+            s->used = 0;
+            s->ready_since = sim_time;
+            queue_push(&q->levels[l - 1], task, next);
+        }
+    }
+}
+
+static void mlfq_init(int cpus) {
+    if (cpus > num_queues) {
+        queues = realloc(queues, cpus * sizeof(MlfqQueue));
+        num_queues = cpus;
+    }
+    for (int c = 0; c < cpus; c++) {
+        for (int l = 0; l < MLFQ_MAX_LEVELS; l++) {
+            queue_init(&queues[c].levels[l]);
+        }
+    }
+    reserve();
+    memset(state, 0, slots * sizeof(MlfqState));
+    epoch = 1;
+    next_boost = mlfq_boost;
+}
+
+static void mlfq_enqueue(int cpu, Task *task) {
+    if (task->tid >= slots) reserve();
+    MlfqState *s = &state[task->tid];
+    if (s->epoch == epoch) {
+        // back from the CPU: charge the slice, demote once the level's
+        // quantum is used; the bottom level is plain round robin
+        s->used += s->picked_burst - task->burst;
+        if (s->used >= quantumOf(s->level)) {
+            if (s->level < mlfq_levels - 1) s->level++;
+            s->used = 0;
+        }
+    } else {
+        // new, or boosted while it ran: start over at the top
+        stateOf(task);
+    }
+    s->ready_since = sim_time;
+    queue_push(&queues[cpu].levels[s->level], task, next);
+}
+
+static Task *mlfq_pick(int cpu) {
+    if (mlfq_boost > 0 && sim_time >= next_boost) {
+        boost();
+        next_boost = (sim_time / mlfq_boost + 1) * mlfq_boost;
+    }
+    if (mlfq_age > 0) {
+        age(&queues[cpu]);
+    }
+    for (int l = 0; l < mlfq_levels; l++) {
+        Task *task = queue_pop(&queues[cpu].levels[l], next);
+        if (task != NULL) {
+            state[task->tid].picked_burst = task->burst;
+            return task;
+        }
+    }
+    return NULL;
+}
+
+// what is left of the quantum at the task's level
+static int mlfq_tick(Task *task) {
+    MlfqState *s = stateOf(task);
+    int left = quantumOf(s->level) - s->used;
+    return task->burst < left ? task->burst : left;
+}
+
+static void mlfq_complete(Task *task) {
+    (void)task;
+}
+
+// the task's level without applying a pending boost; a boost reaches a
+// task only when it is enqueued or picked
+static int levelOf(Task *task) {
+    MlfqState *s = &state[task->tid];
+    return s->epoch == epoch ? s->level : 0;
+}
+
+// a newcomer on a higher level takes the CPU; the running task keeps the
+// level it was picked from
+static int mlfq_preempt(Task *running, Task *arrived) {
+    return levelOf(arrived) < state[running->tid].level;
+}
+
+Policy mlfq_policy = {
+    "mlfq", mlfq_init, mlfq_enqueue, mlfq_pick, mlfq_tick, mlfq_complete, mlfq_preempt
+};
@@ -1,93 +1,71 @@
 /**
  * schedule_priority.c
- * Implements Priority scheduling (non-preemptive).
- * add(): enqueue tasks with metadata; schedule(): execute by highest priority.
+ * Implements Priority scheduling, non-preemptive (priority) and
+ * preemptive (priority_preempt).
+ * pick(): highest priority first, ties broken by name; tick(): whole burst.
+ * priority_preempt preempts when a task of higher priority arrives.
+ * The ready queue is a heap, so each pick is O(log n).
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include "task.h"
-#include "list.h"
+#include "heap.h"
 #include "schedulers.h"
-#include "cpu.h"
+#include "metrics.h"
 
-extern int task_count;
-extern char *metric_names[];
-extern int metric_arrival[];
-extern int metric_start[];
-extern int metric_finish[];
-extern int metric_burst[];
+static _Thread_local Heap *ready = NULL;      // one heap per CPU
+static _Thread_local int num_heaps = 0;
 
-struct node *g_head = NULL;
+// higher priority first, then name order; a later duplicate goes first
+static bool comesBefore(Task *a, Task *b) {
+    if (a->priority != b->priority) return a->priority > b->priority;
+    int names = compare_task_names(a, b);
+    if (names != 0) return names < 0;
+    return a->tid > b->tid;
+}
 
-/**
- * add
- * Create a Task and add it to the scheduler's list.
- * Initializes timing metrics for later reporting.
- */
-void add(char *name, int priority, int burst) {
-    Task *task = malloc(sizeof(Task));
-    task->name = strdup(name);
-    task->priority = priority;
-    task->burst = burst;
-    task->original_burst = burst;
-    task->arrival_time = 0;
-    task->start_time = -1;
-    task->finish_time = -1;
-    task->tid = task_count;
-    metric_names[task_count] = task->name;
-    metric_arrival[task_count] = 0;
-    metric_burst[task_count] = burst;
-    metric_start[task_count] = -1;
-    metric_finish[task_count] = -1;
-    task_count++;
-    insert(&g_head, task);
+static void priority_init(int cpus) {
+    // grow ready without losing the item buffers of existing heaps
+    if (cpus > num_heaps) {
+        ready = realloc(ready, cpus * sizeof(Heap));
+        memset(ready + num_heaps, 0, (cpus - num_heaps) * sizeof(Heap));
+        num_heaps = cpus;
+    }
+    for (int c = 0; c < cpus; c++) {
+        heap_init(&ready[c], comesBefore);
+    }
 }
 
-bool comesBefore(char *a, char *b) {
-    return strcmp(a, b) < 0;
+static void priority_enqueue(int cpu, Task *task) {
+    heap_push(&ready[cpu], task);
 }
 
-Task *pickNextTask() {
-    if (!g_head) return NULL;
+static Task *priority_pick(int cpu) {
+    return heap_pop(&ready[cpu]);
+}
 
-    struct node *temp = g_head;
-    Task *best = temp->task;
-    while (temp) {
-        if (temp->task->priority > best->priority ||
-           (temp->task->priority == best->priority && comesBefore(temp->task->name, best->name))) {
-            best = temp->task;
-        }
-        temp = temp->next;
-    }
-    delete(&g_head, best);
-    return best;
+// Priority always runs to completion
+static int priority_tick(Task *task) {
+    return task->burst;
 }
 
-/**
- * schedule
- * Execute the Priority scheduling loop until all tasks complete.
- * Records each task's start and finish times for metrics.
- */
-void schedule() {
-    Task *task;
-    int currentTime = 0;
-    while ((task = pickNextTask()) != NULL) {
-        if (metric_start[task->tid] < 0) {
-            metric_start[task->tid] = currentTime;
-        }
-        run(task, task->burst);
-        currentTime += task->burst;
-        if (task->burst == 0) {
-            metric_finish[task->tid] = currentTime;
-        }
-        else if (task->burst > 0) {
-            // Priority always runs to completion
-            metric_finish[task->tid] = currentTime;
-        }
-        printf("\tTime is now: %d\n", currentTime);
-        // free(task->name);
-        free(task);
-    }
-}
\ No newline at end of file
+static void priority_complete(Task *task) {
+    (void)task;
+}
+
+// a strictly higher priority arrival takes the CPU
+static int priority_preempt(Task *running, Task *arrived) {
+    return arrived->priority > running->priority;
+}
+
+Policy priority_policy = {
+    "priority", priority_init, priority_enqueue, priority_pick, priority_tick, priority_complete,
+    NULL
+};
+
+Policy priority_preempt_policy = {
+    "priority_preempt", priority_init, priority_enqueue, priority_pick, priority_tick,
+    priority_complete, priority_preempt
+};
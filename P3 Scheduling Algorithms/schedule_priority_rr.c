@@ -1,119 +1,139 @@
 /**
  * schedule_priority_rr.c
  * Implements Priority Round Robin scheduling.
- * add(): enqueue tasks with metadata; schedule(): execute in priority-quantum slices.
+ * Each CPU's ready queue has one FIFO per priority level and a bitmap of
+ * the non-empty levels, so finding the highest ready level is a count of
+ * leading zeros and every enqueue and pick is O(1) apart from sorting.
+ * Tasks that have not run yet wait in their level's pending list and are
+ * appended to the FIFO in name order the next time the level is touched,
+ * so each level is round-robined in name order; a preempted task goes to
+ * the tail of its FIFO.
+ * pick(): head of the highest level; tick(): one quantum.
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "task.h"
 #include "list.h"
 #include "schedulers.h"
-#include "cpu.h"
+#include "metrics.h"
 
-extern int task_count;
-extern char *metric_names[];
-extern int metric_arrival[];
-extern int metric_start[];
-extern int metric_finish[];
-extern int metric_burst[];
+#define BITMAP_WORDS ((PRIORITY_LEVELS + 63) / 64)
 
-#define QUANTUM 10
+typedef struct level {
+    Queue fifo;         // tasks ready at this priority
+    Task **pending;     // tasks that have not run yet, unsorted
+    int num_pending;
+    int pending_capacity;
+} Level;
 
-struct node *g_head = NULL;
+// ready structure of one CPU
+typedef struct run_queue {
+    Level levels[PRIORITY_LEVELS];
+    uint64_t nonempty[BITMAP_WORDS];    // bit p set if level p has tasks
+} RunQueue;
 
-/**
- * add
- * Create a Task and append it to the scheduler's queue.
- * Initializes timing metrics for later reporting.
- */
-void add(char *name, int priority, int burst) {
-    Task *task = malloc(sizeof(Task));
-    task->name = strdup(name);
-    task->priority = priority;
-    task->burst = burst;
-    task->original_burst = burst;
-    task->arrival_time = 0;
-    task->start_time = -1;
-    task->finish_time = -1;
-    task->tid = task_count;
-    metric_names[task_count] = task->name;
-    metric_arrival[task_count] = 0;
-    metric_burst[task_count] = burst;
-    metric_start[task_count] = -1;
-    metric_finish[task_count] = -1;
-    task_count++;
-    insert(&g_head, task);
+static _Thread_local RunQueue *queues = NULL;         // one per CPU
+static _Thread_local int num_queues = 0;
+static _Thread_local Task **next = NULL;              // FIFO successor of each task id
+static _Thread_local int slots = 0;                   // task ids next has room for
+
+// grow next to cover every task id; the workload grows while streaming
+static void reserve() {
+    if (slots < metrics.capacity) {
+        slots = metrics.capacity;
+        next = realloc(next, slots * sizeof(Task *));
+    }
+}
+
+// priorities outside the supported levels share the nearest level
+static int levelOf(Task *task) {
+    if (task->priority < 0) return 0;
+    if (task->priority >= PRIORITY_LEVELS) return PRIORITY_LEVELS - 1;
+    return task->priority;
 }
 
-// compare for priority-order then lex
-int compareTasks(const void *a, const void *b) {
+// name order; a later duplicate goes first
+static int compareTasks(const void *a, const void *b) {
     Task *ta = *(Task **)a;
     Task *tb = *(Task **)b;
-    if (ta->priority != tb->priority) {
-        return tb->priority - ta->priority;
-    }
-    return strcmp(ta->name, tb->name);
+    int names = compare_task_names(ta, tb);
+    if (names != 0) return names < 0 ? -1 : 1;
+    return tb->tid - ta->tid;
 }
 
-/**
- * schedule
- * Execute the Priority Round Robin scheduling loop until all tasks complete.
- * Records each task's start and finish times for metrics.
- */
-void schedule() {
-    // move tasks into array and sort by priority/name
-    Task *tasks[100];
-    int n = 0;
-    struct node *cur = g_head;
-    while (cur) {
-        tasks[n++] = cur->task;
-        struct node *tmp = cur;
-        cur = cur->next;
-        free(tmp);
+// move pending tasks to the FIFO in name order
+static void flush(Level *level) {
+    if (level->num_pending == 0) return;
+    qsort(level->pending, level->num_pending, sizeof(Task *), compareTasks);
+    for (int i = 0; i < level->num_pending; i++) {
+        queue_push(&level->fifo, level->pending[i], next);
     }
-    g_head = NULL;
+    level->num_pending = 0;
+}
 
-    qsort(tasks, n, sizeof(Task *), compareTasks);
+static void priority_rr_init(int cpus) {
+    // grow queues without losing the pending buffers of existing ones
+    if (cpus > num_queues) {
+        queues = realloc(queues, cpus * sizeof(RunQueue));
+        memset(queues + num_queues, 0, (cpus - num_queues) * sizeof(RunQueue));
+        num_queues = cpus;
+    }
+    for (int c = 0; c < cpus; c++) {
+        for (int p = 0; p < PRIORITY_LEVELS; p++) {
+            queue_init(&queues[c].levels[p].fifo);
+            queues[c].levels[p].num_pending = 0;
+        }
+        memset(queues[c].nonempty, 0, sizeof(queues[c].nonempty));
+    }
+    reserve();
+}
 
-    int currentTime = 0;
-    int remaining = n;
-    while (remaining > 0) {
-        // Determine highest priority among remaining tasks
-        int maxPrio = -1;
-        for (int i = 0; i < n; i++) {
-            if (tasks[i] && tasks[i]->burst > 0 && tasks[i]->priority > maxPrio) {
-                maxPrio = tasks[i]->priority;
-            }
+static void priority_rr_enqueue(int cpu, Task *task) {
+    if (task->tid >= slots) reserve();
+    int p = levelOf(task);
+    Level *level = &queues[cpu].levels[p];
+    if (metrics.start[task->tid] < 0) {
+        if (level->num_pending == level->pending_capacity) {
+            level->pending_capacity = level->pending_capacity ? level->pending_capacity * 2 : 64;
+            level->pending = realloc(level->pending, level->pending_capacity * sizeof(Task *));
         }
-        // Round-robin among tasks of highest priority
-        bool groupRemaining = true;
-        while (groupRemaining) {
-            groupRemaining = false;
-            for (int i = 0; i < n; i++) {
-                if (tasks[i] && tasks[i]->priority == maxPrio && tasks[i]->burst > 0) {
-                    int slice = tasks[i]->burst > QUANTUM ? QUANTUM : tasks[i]->burst;
-                    if (metric_start[tasks[i]->tid] < 0) {
-                        metric_start[tasks[i]->tid] = currentTime;
-                    }
-                    run(tasks[i], slice);
-                    tasks[i]->burst -= slice;
-                    currentTime += slice;
-                    if (tasks[i]->burst == 0) {
-                        metric_finish[tasks[i]->tid] = currentTime;
-                    }
-                    printf("\tTime is now: %d\n", currentTime);
-                    if (tasks[i]->burst == 0) {
-                        // free(tasks[i]->name);
-                        free(tasks[i]);
-                        tasks[i] = NULL;
-                        remaining--;
-                    } else {
-                        groupRemaining = true;
-                    }
-                }
-            }
+        level->pending[level->num_pending++] = task;
+    } else {
+        // tasks that became ready earlier go ahead of the preempted one
+        flush(level);
+        queue_push(&level->fifo, task, next);
+    }
+    queues[cpu].nonempty[p / 64] |= (uint64_t)1 << (p % 64);
+}
+
+static Task *priority_rr_pick(int cpu) {
+    uint64_t *nonempty = queues[cpu].nonempty;
+    for (int w = BITMAP_WORDS - 1; w >= 0; w--) {
+        if (nonempty[w] == 0) continue;
+        int p = w * 64 + 63 - __builtin_clzll(nonempty[w]);
+        Level *level = &queues[cpu].levels[p];
+        flush(level);
+        Task *task = queue_pop(&level->fifo, next);
+        if (level->fifo.head == NULL) {
+            nonempty[w] &= ~((uint64_t)1 << (p % 64));
         }
+        return task;
     }
-}
\ No newline at end of file
+    return NULL;
+}
+
+static int priority_rr_tick(Task *task) {
+    return task->burst > quantum ? quantum : task->burst;
+}
+
+static void priority_rr_complete(Task *task) {
+    (void)task;
+}
+
+Policy priority_rr_policy = {
+    "priority_rr", priority_rr_init, priority_rr_enqueue, priority_rr_pick,
+    priority_rr_tick, priority_rr_complete, NULL
+};
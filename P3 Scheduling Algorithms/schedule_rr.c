@@ -1,7 +1,9 @@
 /**
  * schedule_rr.c
  * Implements Round Robin scheduling.
- * add(): enqueue tasks in arrival order; schedule(): execute in fixed quantums.
+ * enqueue(): append to the tail; pick(): take the head; tick(): one quantum.
+ * A preempted task goes back to the tail, so tasks run in arrival order, one
+ * quantum each, pass after pass.
  */
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,96 +12,45 @@
 #include "task.h"
 #include "list.h"
 #include "schedulers.h"
-#include "cpu.h"
+#include "metrics.h"
 
-extern int task_count;
-extern char *metric_names[];
-extern int metric_arrival[];
-extern int metric_start[];
-extern int metric_finish[];
-extern int metric_burst[];
+static _Thread_local Queue *ready = NULL;     // one FIFO per CPU
+static _Thread_local Task **next = NULL;      // FIFO successor of each task id
+static _Thread_local int slots = 0;           // task ids next has room for
 
-#define QUANTUM 10
-
-struct node *g_head = NULL;
-
-/**
- * add
- * Create a Task and append it to the round-robin queue.
- * Initializes timing metrics for later reporting.
- */
-void add(char *name, int priority, int burst) {
-    Task *task = malloc(sizeof(Task));
-    task->name = strdup(name);
-    task->priority = priority;
-    task->burst = burst;
-    task->original_burst = burst;
-    task->arrival_time = 0;
-    task->start_time = -1;
-    task->finish_time = -1;
-    task->tid = task_count;
-    metric_names[task_count] = task->name;
-    metric_arrival[task_count] = 0;
-    metric_burst[task_count] = burst;
-    metric_start[task_count] = -1;
-    metric_finish[task_count] = -1;
-    task_count++;
-    // Append the new task to the end of the list to preserve arrival order
-    struct node *new_node = malloc(sizeof(struct node));
-    new_node->task = task;
-    new_node->next = NULL;
-    if (g_head == NULL) {
-        g_head = new_node;
-    } else {
-        struct node *cur_node = g_head;
-        while (cur_node->next != NULL) {
-            cur_node = cur_node->next;
-        }
-        cur_node->next = new_node;
+// grow next to cover every task id; the workload grows while streaming
+static void reserve() {
+    if (slots < metrics.capacity) {
+        slots = metrics.capacity;
+        next = realloc(next, slots * sizeof(Task *));
     }
 }
 
-/**
- * schedule
- * Execute the Round Robin scheduling loop until all tasks complete.
- * Records each task's start and finish times for metrics.
- */
-void schedule() {
-    // move tasks to an array for round-robin
-    Task *tasks[100];
-    int n = 0;
-    struct node *cur = g_head;
-    while (cur) {
-        tasks[n++] = cur->task;
-        struct node *tmp = cur;
-        cur = cur->next;
-        free(tmp);
+static void rr_init(int cpus) {
+    ready = realloc(ready, cpus * sizeof(Queue));
+    for (int c = 0; c < cpus; c++) {
+        queue_init(&ready[c]);
     }
-    g_head = NULL;
+    reserve();
+}
 
-    int currentTime = 0;
-    int remaining = n;
-    while (remaining > 0) {
-        for (int i = 0; i < n; i++) {
-            if (tasks[i] && tasks[i]->burst > 0) {
-                int slice = tasks[i]->burst > QUANTUM ? QUANTUM : tasks[i]->burst;
-                if (metric_start[tasks[i]->tid] < 0) {
-                    metric_start[tasks[i]->tid] = currentTime;
-                }
-                run(tasks[i], slice);
-                tasks[i]->burst -= slice;
-                currentTime += slice;
-                if (tasks[i]->burst == 0) {
-                    metric_finish[tasks[i]->tid] = currentTime;
-                }
-                printf("\tTime is now: %d\n", currentTime);
-                if (tasks[i]->burst == 0) {
-                    // free(tasks[i]->name);
-                    free(tasks[i]);
-                    tasks[i] = NULL;
-                    remaining--;
-                }
-            }
-        }
-    }
-}
\ No newline at end of file
+static void rr_enqueue(int cpu, Task *task) {
+    if (task->tid >= slots) reserve();
+    queue_push(&ready[cpu], task, next);
+}
+
+static Task *rr_pick(int cpu) {
+    return queue_pop(&ready[cpu], next);
+}
+
+static int rr_tick(Task *task) {
+    return task->burst > quantum ? quantum : task->burst;
+}
+
+static void rr_complete(Task *task) {
+    (void)task;
+}
+
+Policy rr_policy = {
+    "rr", rr_init, rr_enqueue, rr_pick, rr_tick, rr_complete, NULL
+};
@@ -0,0 +1,440 @@
+/**
+ * scheduler.c
+ * Shared add() and the policy-independent discrete-event scheduling loop.
+ * The workload is parsed once into the metric columns; every schedule
+ * builds fresh Task records from it in a bulk arena, so several policies
+ * can be compared in one process.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "task.h"
+#include "schedulers.h"
+#include "cpu.h"
+#include "metrics.h"
+#include "trace.h"
+#include "stats.h"
+
+Policy *policies[] = {
+    &fcfs_policy, &sjf_policy, &rr_policy, &priority_policy, &priority_rr_policy,
+    &srtf_policy, &priority_preempt_policy, &mlfq_policy
+};
+int policy_count = sizeof(policies) / sizeof(policies[0]);
+
+_Thread_local int quantum = QUANTUM;
+_Thread_local int cpus = 1;
+_Thread_local int migration_penalty = MIGRATION_PENALTY;
+_Thread_local int sim_time = 0;
+
+// Task records come from chunks of TASK_CHUNK tasks that are kept and
+// rewound between schedules rather than freed
+typedef struct task_chunk {
+    struct task_chunk *next;
+    Task tasks[TASK_CHUNK];
+} TaskChunk;
+
+static _Thread_local TaskChunk *chunk_head = NULL;
+static _Thread_local TaskChunk *chunk_current = NULL;
+static _Thread_local int chunk_used = 0;
+
+/**
+ * task_alloc
+ * Hand out the next Task record of the arena, adding a chunk when the
+ * current one is full.
+ * @return An uninitialized Task
+ */
+static Task *task_alloc() {
+    if (chunk_current == NULL || chunk_used == TASK_CHUNK) {
+        TaskChunk *next = chunk_current ? chunk_current->next : chunk_head;
+        if (next == NULL) {
+            next = malloc(sizeof(TaskChunk));
+            next->next = NULL;
+            if (chunk_current) {
+                chunk_current->next = next;
+            } else {
+                chunk_head = next;
+            }
+        }
+        chunk_current = next;
+        chunk_used = 0;
+    }
+    return &chunk_current->tasks[chunk_used++];
+}
+
+/**
+ * task_arena_reset
+ * Make every Task record available again; nothing is freed.
+ */
+static void task_arena_reset() {
+    chunk_current = NULL;
+    chunk_used = 0;
+}
+
+/**
+ * add
+ * Append a task to the workload; its name is interned.
+ * @param name      Task name
+ * @param priority  Task priority
+ * @param burst     CPU burst length
+ * @param arrival   Time the task becomes ready
+ */
+void add(char *name, int priority, int burst, int arrival) {
+    metrics_add(name, strlen(name), priority, burst, arrival);
+}
+
+/**
+ * find_policy
+ * Look up a policy by its --policy name.
+ * @param name  Policy name
+ * @return The policy, or NULL if none has that name
+ */
+Policy *find_policy(const char *name) {
+    for (int i = 0; i < policy_count; i++) {
+        if (strcmp(policies[i]->name, name) == 0) {
+            return policies[i];
+        }
+    }
+    return NULL;
+}
+
+// Simulation events, ordered by time; at one instant arrivals come first so
+// a task preempted or expiring then queues behind the new arrivals
+enum { EVENT_ARRIVAL, EVENT_SLICE_END };
+
+typedef struct event {
+    int time;
+    int type;           // EVENT_ARRIVAL or EVENT_SLICE_END
+    int cpu;            // CPU whose slice ends
+    unsigned seq;       // slice number; a preempted slice's end is stale
+} Event;
+
+static _Thread_local Event *events = NULL;
+static _Thread_local int num_events = 0;
+static _Thread_local int events_capacity = 0;
+
+// what each simulated CPU is doing
+typedef struct core {
+    Task *running;      // task on the CPU, NULL if idle
+    int slice_start;    // when the running slice was dispatched
+    int penalty;        // migration units at the start of the slice
+    int slice_end;      // when the running slice ends
+    unsigned seq;       // number of the live slice
+    int queued;         // tasks in this CPU's ready queue
+    int idle_since;     // when the CPU last became idle
+} Core;
+
+static _Thread_local Core *core = NULL;
+
+/**
+ * event_before
+ * True if event a happens before event b.
+ */
+static int event_before(Event *a, Event *b) {
+    if (a->time != b->time) return a->time < b->time;
+    if (a->type != b->type) return a->type < b->type;
+    return a->cpu < b->cpu;
+}
+
+/**
+ * event_push
+ * Add an event to the binary heap of pending events.
+ */
+static void event_push(int time, int type, int cpu, unsigned seq) {
+    if (num_events == events_capacity) {
+        events_capacity = events_capacity ? events_capacity * 2 : 16;
+        events = realloc(events, events_capacity * sizeof(Event));
+    }
+    Event ev = {time, type, cpu, seq};
+    int slot = num_events++;
+    while (slot > 0 && event_before(&ev, &events[(slot - 1) / 2])) {
+        events[slot] = events[(slot - 1) / 2];
+        slot = (slot - 1) / 2;
+    }
+    events[slot] = ev;
+}
+
+/**
+ * event_pop
+ * Remove the earliest pending event.
+ * @param ev  Receives the event
+ * @return 0 if no event is pending
+ */
+static int event_pop(Event *ev) {
+    if (num_events == 0) return 0;
+    *ev = events[0];
+    Event last = events[--num_events];
+    int slot = 0;
+    while (2 * slot + 1 < num_events) {
+        int child = 2 * slot + 1;
+        if (child + 1 < num_events && event_before(&events[child + 1], &events[child])) child++;
+        if (!event_before(&events[child], &last)) break;
+        events[slot] = events[child];
+        slot = child;
+    }
+    events[slot] = last;
+    return 1;
+}
+
+/**
+ * drop_stale
+ * Discard slice ends left at the top of the heap by preempted slices, so
+ * the next event looked at is a live one.
+ */
+static void drop_stale() {
+    Event ev;
+    while (num_events > 0 && events[0].type == EVENT_SLICE_END &&
+           events[0].seq != core[events[0].cpu].seq) {
+        event_pop(&ev);
+    }
+}
+
+static int compare_arrivals(const void *a, const void *b) {
+    int ta = *(const int *)a, tb = *(const int *)b;
+    if (metrics.arrival[ta] != metrics.arrival[tb]) {
+        return metrics.arrival[ta] < metrics.arrival[tb] ? -1 : 1;
+    }
+    return ta - tb;
+}
+
+/**
+ * arrival_order
+ * Task ids ordered by arrival time, then by input order.
+ * @return Array of metrics.count ids; the caller frees it
+ */
+static int *arrival_order() {
+    int *order = malloc((metrics.count ? metrics.count : 1) * sizeof(int));
+    int sorted = 1;
+    for (int i = 0; i < metrics.count; i++) {
+        order[i] = i;
+        if (i > 0 && metrics.arrival[i] < metrics.arrival[i - 1]) sorted = 0;
+    }
+    if (!sorted) {
+        qsort(order, metrics.count, sizeof(int), compare_arrivals);
+    }
+    return order;
+}
+
+/**
+ * next_arrival
+ * The id of the next task to arrive: pulled from the feed, or the next in
+ * arrival order of the loaded workload.
+ * @param feed     Task source, or NULL
+ * @param order    Arrival order of the loaded workload, when feed is NULL
+ * @param arrived  Tasks taken from order so far
+ * @return Task id, or -1 when no task is left
+ */
+static int next_arrival(int (*feed)(void), int *order, int *arrived) {
+    if (feed != NULL) return feed();
+    return *arrived < metrics.count ? order[(*arrived)++] : -1;
+}
+
+/**
+ * least_loaded
+ * The CPU with the fewest running plus queued tasks, lowest number first.
+ */
+static int least_loaded() {
+    int best = 0, best_load = -1;
+    for (int c = 0; c < cpus; c++) {
+        int load = core[c].queued + (core[c].running != NULL);
+        if (best_load < 0 || load < best_load) {
+            best = c;
+            best_load = load;
+        }
+    }
+    return best;
+}
+
+/**
+ * end_slice
+ * Charge a task for the units it ran and queue it again on the same CPU,
+ * or complete it once its burst is used up. The CPU becomes idle. A slice
+ * cut short before it ran anything is not a run: nothing is charged and
+ * the task just goes back to the queue.
+ * @param policy  Policy of the schedule
+ * @param cpu     CPU the slice ran on
+ * @param ran     Units the task ran in this slice
+ * @param now     Current time
+ */
+static void end_slice(Policy *policy, int cpu, int ran, int now) {
+    Task *task = core[cpu].running;
+    if (ran > 0) {
+        run(cpu, task, ran, now);
+        task->burst -= ran;
+    }
+    if (task->burst == 0) {
+        metrics.finish[task->tid] = now;
+        stats_record(metrics.arrival[task->tid], metrics.start[task->tid], now,
+                     metrics.burst[task->tid]);
+        policy->complete(task);
+    } else {
+        policy->enqueue(cpu, task);
+        core[cpu].queued++;
+    }
+    core[cpu].running = NULL;
+    core[cpu].idle_since = now;
+}
+
+/**
+ * dispatch
+ * Give an idle CPU its next task: the pick of its own queue, or else one
+ * stolen from the CPU with the most queued tasks. A task resuming on a
+ * CPU other than its last one pays the migration penalty first.
+ * @param policy  Policy of the schedule
+ * @param cpu     Idle CPU
+ * @param now     Current time
+ */
+static void dispatch(Policy *policy, int cpu, int now) {
+    int from = cpu;
+    if (core[cpu].queued == 0) {
+        for (int c = 0; c < cpus; c++) {
+            if (core[c].queued > core[from].queued) from = c;
+        }
+        if (core[from].queued == 0) return;
+    }
+    Task *task = policy->pick(from);
+    if (task == NULL) return;
+    core[from].queued--;
+
+    if (now > core[cpu].idle_since) {
+        idle(cpu, now - core[cpu].idle_since, now);
+    }
+    int penalty = 0;
+    if (task->cpu >= 0 && task->cpu != cpu) {
+        penalty = migration_penalty;
+        migrate(cpu, task, penalty, now);
+    }
+    task->cpu = cpu;
+    if (metrics.start[task->tid] < 0) {
+        metrics.start[task->tid] = now;
+    }
+
+    Core *c = &core[cpu];
+    c->running = task;
+    c->slice_start = now;
+    c->penalty = penalty;
+    c->slice_end = now + penalty + policy->tick(task);
+    event_push(c->slice_end, EVENT_SLICE_END, cpu, ++c->seq);
+}
+
+/**
+ * schedule_with
+ * Simulate the loaded workload under a policy until all tasks complete.
+ * @param policy  Policy deciding which task runs and for how long
+ */
+void schedule_with(Policy *policy) {
+    schedule_from(policy, NULL);
+}
+
+/**
+ * schedule_from
+ * Simulate a workload under a policy until all tasks complete.
+ * The clock jumps from event to event: each task's arrival and the end of
+ * each CPU's running slice (quantum expiry or completion). An arriving
+ * task joins the least loaded CPU and may cut its running slice short if
+ * the policy preempts. Once every event of an instant is handled, each
+ * idle CPU dispatches its own pick or steals work from the busiest queue.
+ * Records each task's start and finish times for metrics.
+ * With a feed, tasks are pulled in one arrival at a time instead of
+ * coming from the loaded workload, so a large input never has to be read
+ * ahead of the simulation.
+ * @param policy  Policy deciding which task runs and for how long
+ * @param feed    Adds the next task and returns its id, -1 at the end;
+ *                arrivals must not decrease. NULL runs the loaded workload.
+ */
+void schedule_from(Policy *policy, int (*feed)(void)) {
+    task_arena_reset();
+    metrics_reset();
+    stats_reset();
+    cpu_init(cpus);
+    rank_names();
+    policy->init(cpus);
+    trace_begin(policy->name, cpus);
+    core = realloc(core, cpus * sizeof(Core));
+    memset(core, 0, cpus * sizeof(Core));
+
+    int *order = feed ? NULL : arrival_order();
+    int arrived = 0;
+    num_events = 0;
+    int next = next_arrival(feed, order, &arrived);
+    if (next >= 0) {
+        event_push(metrics.arrival[next], EVENT_ARRIVAL, 0, 0);
+    }
+
+    int currentTime = 0;
+    sim_time = 0;
+    Event ev;
+    while (true) {
+        drop_stale();
+        if (!event_pop(&ev)) break;
+        currentTime = ev.time;
+        sim_time = currentTime;
+
+        if (ev.type == EVENT_ARRIVAL) {
+            int tid = next;
+            next = next_arrival(feed, order, &arrived);
+            if (next >= 0) {
+                event_push(metrics.arrival[next], EVENT_ARRIVAL, 0, 0);
+            }
+            Task *task = task_alloc();
+            task->name = metrics.name[tid];
+            task->tid = tid;
+            task->priority = metrics.priority[tid];
+            task->burst = metrics.burst[tid];
+            task->rank = name_rank(task->name);
+            task->cpu = -1;
+            int cpu = least_loaded();
+            policy->enqueue(cpu, task);
+            core[cpu].queued++;
+
+            Core *c = &core[cpu];
+            if (c->running != NULL && policy->preempt != NULL && currentTime < c->slice_end) {
+                // compare against what the running task has left right now
+                int ran = currentTime - c->slice_start - c->penalty;
+                if (ran < 0) ran = 0;
+                c->running->burst -= ran;
+                int preempted = policy->preempt(c->running, task);
+                c->running->burst += ran;
+                if (preempted) {
+                    if (ran == 0) {
+                        // cut inside the migration penalty: the units spent
+                        // moving count, the rest of the penalty never happens,
+                        // and a first dispatch does not count as a response
+                        cut_migration(cpu, c->penalty - (currentTime - c->slice_start));
+                        if (metrics.start[c->running->tid] == c->slice_start) {
+                            metrics.start[c->running->tid] = -1;
+                        }
+                    }
+                    end_slice(policy, cpu, ran, currentTime);
+                    c->seq++;
+                }
+            }
+        } else {
+            Core *c = &core[ev.cpu];
+            end_slice(policy, ev.cpu, c->slice_end - c->slice_start - c->penalty, currentTime);
+        }
+
+        // dispatch only after every event of this instant is handled
+        drop_stale();
+        if (num_events == 0 || events[0].time > currentTime) {
+            for (int c = 0; c < cpus; c++) {
+                if (core[c].running == NULL) dispatch(policy, c, currentTime);
+            }
+        }
+    }
+
+    // CPUs that ran out of work before the last task finished sat idle
+    for (int c = 0; c < cpus; c++) {
+        cores[c].idle_time += currentTime - core[c].idle_since;
+    }
+    trace_end();
+    free(order);
+}
+
+/**
+ * schedule
+ * Run the workload under FCFS.
+ */
+void schedule() {
+    schedule_with(&fcfs_policy);
+}
@@ -1,8 +1,92 @@
+/**
+ * schedulers.h
+ * Shared workload, policy interface and scheduling loop.
+ * Every policy plugs into the same loop through init/enqueue/pick/tick/complete,
+ * and preemptive ones also through preempt.
+ */
+
+#ifndef SCHEDULERS_H
+#define SCHEDULERS_H
+
+#include "task.h"
+
 #define MIN_PRIORITY 1
 #define MAX_PRIORITY 10
 
-// add a task to the list 
-void add(char *name, int priority, int burst);
+// ready-queue levels of priority round robin (priorities 0..139, as Linux)
+#define PRIORITY_LEVELS 140
+
+// multilevel feedback queue defaults: levels, boost period and aging limit
+#define MLFQ_LEVELS 3
+#define MLFQ_MAX_LEVELS 16
+#define MLFQ_BOOST 200
+#define MLFQ_AGE 100
+
+// Task records per arena chunk
+#define TASK_CHUNK 65536
+
+/**
+ * A scheduling policy.
+ * A policy keeps one ready queue per CPU. The loop enqueues each task on a
+ * CPU as it arrives and, whenever a CPU is free, picks one from its queue
+ * (or steals one from the busiest other queue), asks tick() for its slice,
+ * runs it and either re-enqueues it on that CPU or hands it to complete().
+ * An arrival ends the running slice early if preempt() says the newcomer
+ * should take the CPU.
+ */
+typedef struct policy {
+    const char *name;                       // name used by --policy
+    void (*init)(int cpus);                 // reset one ready queue per CPU
+    void (*enqueue)(int cpu, Task *task);   // task became ready (new or preempted)
+    Task *(*pick)(int cpu);                 // remove and return the next task, NULL if empty
+    int (*tick)(Task *task);                // units the picked task may run now
+    void (*complete)(Task *task);           // task finished its burst
+    int (*preempt)(Task *running, Task *arrived); // NULL if never preempts
+} Policy;
+
+extern Policy fcfs_policy;
+extern Policy sjf_policy;
+extern Policy rr_policy;
+extern Policy priority_policy;
+extern Policy priority_rr_policy;
+extern Policy srtf_policy;
+extern Policy priority_preempt_policy;
+extern Policy mlfq_policy;
+
+// every policy, in the order --policy=all runs them
+extern Policy *policies[];
+extern int policy_count;
+
+// time quantum for the round-robin policies
+extern _Thread_local int quantum;
 
-// invoke the scheduler
+// MLFQ levels, per-level quanta (0: quantum doubled per level), boost
+// period and aging limit; 0 turns boosting or aging off
+extern int mlfq_levels;
+extern int mlfq_quanta[MLFQ_MAX_LEVELS];
+extern int mlfq_boost;
+extern int mlfq_age;
+
+// current simulated time, for policies that age tasks
+extern _Thread_local int sim_time;
+
+// simulated CPUs and the cost of resuming a task on another one
+extern _Thread_local int cpus;
+extern _Thread_local int migration_penalty;
+
+// add a task to the workload
+void add(char *name, int priority, int burst, int arrival);
+
+// look up a policy by name, NULL if unknown
+Policy *find_policy(const char *name);
+
+// run the workload under a policy
+void schedule_with(Policy *policy);
+
+// run a policy over tasks pulled from feed in arrival order as they arrive
+void schedule_from(Policy *policy, int (*feed)(void));
+
+// run the workload under the default policy
 void schedule();
+
+#endif
@@ -0,0 +1,140 @@
+/**
+ * stats.c
+ * Constant-memory histograms and fairness sums for schedule metrics.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "stats.h"
+
+_Thread_local Stats stats;
+
+/**
+ * bucket_of
+ * Histogram bucket of a non-negative value.
+ */
+static int bucket_of(int value) {
+    if (value < HIST_SUB) return value;
+    int msb = 31 - __builtin_clz(value);
+    int shift = msb - HIST_SUB_BITS + 1;
+    return shift * (HIST_SUB / 2) + (value >> shift);
+}
+
+/**
+ * bucket_top
+ * Largest value that falls into a bucket.
+ */
+static int bucket_top(int bucket) {
+    if (bucket < HIST_SUB) return bucket;
+    int shift = (bucket - HIST_SUB) / (HIST_SUB / 2) + 1;
+    long low = (long)(bucket - shift * (HIST_SUB / 2)) << shift;
+    long top = low + (1L << shift) - 1;
+    return top > 0x7fffffff ? 0x7fffffff : (int)top;
+}
+
+static void histogram_add(Histogram *h, int value) {
+    if (value < 0) value = 0;
+    h->counts[bucket_of(value)]++;
+    h->total++;
+    h->sum += value;
+    if (value > h->max) h->max = value;
+}
+
+/**
+ * stats_reset
+ * Forget every recorded task.
+ */
+void stats_reset() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * stats_record
+ * Add one completed task.
+ * @param arrival  Arrival time
+ * @param start    First dispatch
+ * @param finish   Completion time
+ * @param burst    Original CPU burst
+ */
+void stats_record(int arrival, int start, int finish, int burst) {
+    int tat = finish - arrival;
+    histogram_add(&stats.tat, tat);
+    histogram_add(&stats.wt, tat - burst);
+    histogram_add(&stats.rt, start - arrival);
+    if (stats.completed == 0 || arrival < stats.first_arrival) stats.first_arrival = arrival;
+    if (finish > stats.last_finish) stats.last_finish = finish;
+    stats.completed++;
+
+    double share = tat > 0 ? (double)burst / tat : 1.0;
+    stats.share_sum += share;
+    stats.share_sq += share * share;
+}
+
+/**
+ * histogram_mean
+ * Exact mean of the recorded values.
+ */
+double histogram_mean(const Histogram *h) {
+    return h->total ? h->sum / h->total : 0;
+}
+
+/**
+ * histogram_percentile
+ * Value at a percentile by nearest rank, as the top of its bucket but
+ * never above the largest value recorded.
+ * @param h           Histogram
+ * @param percentile  0 to 100
+ */
+int histogram_percentile(const Histogram *h, double percentile) {
+    if (h->total == 0) return 0;
+    long rank = (long)(percentile / 100.0 * h->total + 0.999999);
+    if (rank < 1) rank = 1;
+    long seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += h->counts[b];
+        if (seen >= rank) {
+            int top = bucket_top(b);
+            return top < h->max ? top : h->max;
+        }
+    }
+    return h->max;
+}
+
+/**
+ * stats_throughput
+ * Completed tasks per time unit of the schedule.
+ */
+double stats_throughput() {
+    int span = stats.last_finish - stats.first_arrival;
+    return span > 0 ? stats.completed / (double)span : 0;
+}
+
+/**
+ * stats_fairness
+ * Jain's index (sum x)^2 / (n * sum x^2) over x = burst / TAT: 1 when every
+ * task got the same share of its turnaround on the CPU, 1/n at worst.
+ */
+double stats_fairness() {
+    if (stats.completed == 0 || stats.share_sq == 0) return 1;
+    return stats.share_sum * stats.share_sum / (stats.completed * stats.share_sq);
+}
+
+static void report_row(const char *label, const Histogram *h) {
+    printf("%s| %9.2f | %7d | %7d | %7d | %7d |\n", label, histogram_mean(h),
+           histogram_percentile(h, 50), histogram_percentile(h, 90),
+           histogram_percentile(h, 99), h->max);
+}
+
+/**
+ * stats_report
+ * Print the distribution of TAT, WT and RT, throughput and fairness.
+ */
+void stats_report() {
+    printf("\n   |      mean |     p50 |     p90 |     p99 |     max |\n");
+    report_row("TAT", &stats.tat);
+    report_row("WT ", &stats.wt);
+    report_row("RT ", &stats.rt);
+    printf("Throughput: %.4f tasks per unit\n", stats_throughput());
+    printf("Fairness (Jain, burst/TAT): %.4f\n", stats_fairness());
+}
@@ -0,0 +1,61 @@
+/**
+ * stats.h
+ * Online schedule statistics in constant memory. Every completing task
+ * adds its TAT, WT and RT to log-linear histograms (HDR style: exact up
+ * to HIST_SUB, then HIST_SUB / 2 buckets per power of two, so percentiles
+ * are within 2 / HIST_SUB of the true value) and its burst / TAT share to
+ * the sums behind Jain's fairness index.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+// sub-buckets per power of two: values below HIST_SUB are exact
+#define HIST_SUB_BITS 7
+#define HIST_SUB (1 << HIST_SUB_BITS)
+
+// buckets covering every non-negative int
+#define HIST_BUCKETS ((32 - HIST_SUB_BITS) * (HIST_SUB / 2) + HIST_SUB / 2)
+
+typedef struct histogram {
+    long counts[HIST_BUCKETS];
+    long total;         // values recorded
+    double sum;         // their sum, for the mean
+    int max;            // largest value recorded
+} Histogram;
+
+typedef struct stats {
+    Histogram tat, wt, rt;
+    long completed;     // tasks finished
+    int first_arrival;  // earliest arrival of a finished task
+    int last_finish;    // latest completion
+    double share_sum;   // sum of burst / TAT
+    double share_sq;    // sum of (burst / TAT)^2
+} Stats;
+
+// statistics of the last schedule, per thread like the rest of its state
+extern _Thread_local Stats stats;
+
+// clear the statistics before a schedule
+void stats_reset();
+
+// add a completed task
+void stats_record(int arrival, int start, int finish, int burst);
+
+// mean of a histogram
+double histogram_mean(const Histogram *h);
+
+// smallest recorded value at or above the given percentile (0-100)
+int histogram_percentile(const Histogram *h, double percentile);
+
+// completions per time unit, from the first arrival to the last finish
+double stats_throughput();
+
+// Jain's fairness index of the tasks' burst / TAT shares, 1 when all equal
+double stats_fairness();
+
+// print mean, p50, p90, p99 and max of TAT, WT and RT with throughput
+// and fairness
+void stats_report();
+
+#endif
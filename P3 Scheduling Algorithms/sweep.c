@@ -0,0 +1,244 @@
+/**
+ * sweep.c
+ * Parallel parameter sweep.
+ * Every configuration is a policy plus one value of each swept parameter.
+ * Worker threads claim configurations from a shared counter and simulate
+ * them with their own thread-local simulator state: CPU counters, event
+ * heap, task arena, ready queues, statistics and start/finish columns. The workload
+ * columns are shared read-only.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "task.h"
+#include "schedulers.h"
+#include "cpu.h"
+#include "metrics.h"
+#include "sweep.h"
+#include "stats.h"
+
+enum { PARAM_QUANTUM, PARAM_DISPATCH, PARAM_MIGRATION, PARAM_CPUS };
+
+static const char *param_names[] = {"quantum", "dispatch", "migration", "cpus"};
+static const int param_minimum[] = {1, 0, 0, 1};
+
+typedef struct range {
+    int param;
+    int first, last, step;
+    int count;              // values in the range
+} Range;
+
+// outcome of one configuration
+typedef struct result {
+    double utilization;
+    double wt_mean, tat_mean, rt_mean;
+    int wt_p99, tat_p99, rt_p99;
+} Result;
+
+static Range ranges[SWEEP_MAX_RANGES];
+static int num_ranges = 0;
+
+// shared with the workers for the duration of sweep_run()
+static Metrics workload;
+static Policy **sweep_policies;
+static int sweep_configs;       // configurations per policy
+static int sweep_total;         // configurations of all policies
+static atomic_int next_config;
+static Result *results;
+static int base_quantum, base_dispatch, base_migration, base_cpus;
+
+/**
+ * sweep_param
+ * Look up the parameter a NAME=... word names.
+ * @param word  Command line word
+ * @return Index into param_names, or -1 if the text before '=' is not a
+ *         sweepable parameter
+ */
+int sweep_param(const char *word) {
+    const char *equals = strchr(word, '=');
+    if (equals == NULL) return -1;
+    for (int i = 0; i < (int)(sizeof(param_names) / sizeof(param_names[0])); i++) {
+        if (strlen(param_names[i]) == (size_t)(equals - word) &&
+            strncmp(word, param_names[i], equals - word) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * sweep_add
+ * Parse a NAME=FIRST[..LAST[:STEP]] range and add it to the sweep.
+ * @param range  Range text, e.g. quantum=1..100
+ * @return 0 on success, -1 if the name or the numbers are invalid
+ */
+int sweep_add(const char *range) {
+    const char *equals = strchr(range, '=');
+    int param = sweep_param(range);
+    if (param < 0 || num_ranges == SWEEP_MAX_RANGES) return -1;
+    for (int i = 0; i < num_ranges; i++) {
+        if (ranges[i].param == param) return -1;
+    }
+
+    Range *r = &ranges[num_ranges];
+    char *end;
+    r->param = param;
+    r->first = strtol(equals + 1, &end, 10);
+    r->last = r->first;
+    r->step = 1;
+    if (end == equals + 1) return -1;
+    if (strncmp(end, "..", 2) == 0) {
+        const char *last = end + 2;
+        r->last = strtol(last, &end, 10);
+        if (end == last) return -1;
+        if (*end == ':') {
+            const char *step = end + 1;
+            r->step = strtol(step, &end, 10);
+            if (end == step) return -1;
+        }
+    }
+    if (*end != '\0' || r->step <= 0 || r->first > r->last ||
+        r->first < param_minimum[param]) {
+        return -1;
+    }
+    r->count = (r->last - r->first) / r->step + 1;
+    num_ranges++;
+    return 0;
+}
+
+/**
+ * sweep_ranges
+ * Number of parameters being swept.
+ */
+int sweep_ranges() {
+    return num_ranges;
+}
+
+/**
+ * config_value
+ * The value a configuration gives one range; the last range varies fastest.
+ * @param config  Configuration index, without the policy
+ * @param r       Range index
+ */
+static int config_value(int config, int r) {
+    for (int i = num_ranges - 1; i > r; i--) {
+        config /= ranges[i].count;
+    }
+    return ranges[r].first + config % ranges[r].count * ranges[r].step;
+}
+
+/**
+ * measure
+ * Summarize the schedule this thread just ran.
+ * @param result  Receives utilization and the WT/TAT/RT statistics
+ */
+static void measure(Result *result) {
+    long busy = 0, total = 0;
+    for (int c = 0; c < num_cpus; c++) {
+        busy += cores[c].cpu_time;
+        total += cores[c].cpu_time + cores[c].dispatch_time +
+                 cores[c].migration_time + cores[c].idle_time;
+    }
+    result->utilization = total > 0 ? busy * 100.0 / total : 0;
+    result->tat_mean = histogram_mean(&stats.tat);
+    result->tat_p99 = histogram_percentile(&stats.tat, 99);
+    result->wt_mean = histogram_mean(&stats.wt);
+    result->wt_p99 = histogram_percentile(&stats.wt, 99);
+    result->rt_mean = histogram_mean(&stats.rt);
+    result->rt_p99 = histogram_percentile(&stats.rt, 99);
+}
+
+/**
+ * sweep_worker
+ * Simulate configurations until none are left.
+ */
+static void *sweep_worker(void *arg) {
+    (void)arg;      // configurations are claimed from next_config, not assigned
+    int n = workload.count ? workload.count : 1;
+    metrics = workload;
+    metrics.start = malloc(n * sizeof(int));
+    metrics.finish = malloc(n * sizeof(int));
+
+    int index;
+    while ((index = atomic_fetch_add(&next_config, 1)) < sweep_total) {
+        int config = index % sweep_configs;
+        quantum = base_quantum;
+        dispatch_cost = base_dispatch;
+        migration_penalty = base_migration;
+        cpus = base_cpus;
+        for (int r = 0; r < num_ranges; r++) {
+            int value = config_value(config, r);
+            switch (ranges[r].param) {
+            case PARAM_QUANTUM: quantum = value; break;
+            case PARAM_DISPATCH: dispatch_cost = value; break;
+            case PARAM_MIGRATION: migration_penalty = value; break;
+            case PARAM_CPUS: cpus = value; break;
+            }
+        }
+        schedule_with(sweep_policies[index / sweep_configs]);
+        measure(&results[index]);
+    }
+
+    free(metrics.start);
+    free(metrics.finish);
+    return NULL;
+}
+
+/**
+ * sweep_run
+ * Simulate every configuration of every selected policy and print one row
+ * per configuration, in policy order and then range order.
+ * @param selected      Policies to sweep
+ * @param num_selected  Number of policies
+ * @param jobs          Worker threads
+ */
+void sweep_run(Policy **selected, int num_selected, int jobs) {
+    sweep_configs = 1;
+    for (int r = 0; r < num_ranges; r++) {
+        sweep_configs *= ranges[r].count;
+    }
+    sweep_total = sweep_configs * num_selected;
+    int total = sweep_total;
+    if (jobs > total) jobs = total;
+
+    // rank names once here; the workers only read the workload
+    rank_names();
+    workload = metrics;
+    sweep_policies = selected;
+    results = malloc(total * sizeof(Result));
+    atomic_store(&next_config, 0);
+    base_quantum = quantum;
+    base_dispatch = dispatch_cost;
+    base_migration = migration_penalty;
+    base_cpus = cpus;
+
+    pthread_t *threads = malloc(jobs * sizeof(pthread_t));
+    for (int j = 0; j < jobs; j++) {
+        pthread_create(&threads[j], NULL, sweep_worker, NULL);
+    }
+    for (int j = 0; j < jobs; j++) {
+        pthread_join(threads[j], NULL);
+    }
+    free(threads);
+
+    printf("%-16s", "policy");
+    for (int r = 0; r < num_ranges; r++) {
+        printf(" %9s", param_names[ranges[r].param]);
+    }
+    printf(" %8s %9s %7s %9s %7s %9s %7s\n",
+           "util%", "WT mean", "WT p99", "TAT mean", "TAT p99", "RT mean", "RT p99");
+    for (int i = 0; i < total; i++) {
+        Result *result = &results[i];
+        printf("%-16s", selected[i / sweep_configs]->name);
+        for (int r = 0; r < num_ranges; r++) {
+            printf(" %9d", config_value(i % sweep_configs, r));
+        }
+        printf(" %8.2f %9.2f %7d %9.2f %7d %9.2f %7d\n", result->utilization,
+               result->wt_mean, result->wt_p99, result->tat_mean, result->tat_p99,
+               result->rt_mean, result->rt_p99);
+    }
+    free(results);
+}
@@ -0,0 +1,30 @@
+/**
+ * sweep.h
+ * Parameter sweeps: run the loaded workload under every combination of
+ * parameter values on a pool of threads and tabulate the results.
+ *
+ *  --sweep quantum=1..100 dispatch=0..5
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "schedulers.h"
+
+// most parameters one sweep can vary
+#define SWEEP_MAX_RANGES 4
+
+// parameter a NAME=... word names, or -1 if it is not a sweep range
+int sweep_param(const char *word);
+
+// parse one NAME=FIRST[..LAST[:STEP]] range; returns 0, or -1 if invalid
+int sweep_add(const char *range);
+
+// number of ranges added so far
+int sweep_ranges();
+
+// run every configuration of every policy on jobs threads and print a
+// table of utilization and mean/p99 WT/TAT/RT
+void sweep_run(Policy **selected, int num_selected, int jobs);
+
+#endif
@@ -1,7 +1,8 @@
 /**
  * task.h
  * Defines the Task struct for the scheduling simulation.
- * Tracks a task's name, ID, priority, burst length, and timing metrics.
+ * Tracks a task's name, ID, priority, remaining burst and name rank; its timing
+ * metrics live in the struct-of-arrays storage of metrics.h, indexed by ID.
  */
 /**
  * Representation of a task in the system.
@@ -12,14 +13,12 @@
 
 // representation of a task
 typedef struct task {
-    char *name;
-    int tid;
+    char *name;     // interned, shared by every task with this name
+    int tid;        // index into the metric columns
     int priority;
-    int burst;
-    int original_burst;
-    int arrival_time;
-    int start_time;
-    int finish_time;
+    int burst;      // remaining burst
+    int rank;       // position of the name in sorted order for ties, -1 if unranked
+    int cpu;        // CPU it last ran on, -1 before its first slice
 } Task;
 
 #endif
@@ -0,0 +1,114 @@
+/**
+ * trace.c
+ * Buffered writer for binary schedule traces.
+ * Records collect in a fixed buffer and go out in large writes, so tracing
+ * a run costs about as much as the simulation itself.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+#include "metrics.h"
+
+int trace_text = 1;
+int tracing = 0;
+
+static FILE *trace_file = NULL;
+static TraceRecord buffer[TRACE_BUFFER];
+static int buffered = 0;
+
+/**
+ * flush
+ * Write out the buffered records.
+ */
+static void flush() {
+    if (buffered > 0) {
+        fwrite(buffer, sizeof(TraceRecord), buffered, trace_file);
+        buffered = 0;
+    }
+}
+
+/**
+ * trace_open
+ * Create or truncate a trace file.
+ * @param path  File to write
+ * @return 0 on success, -1 if it cannot be opened
+ */
+int trace_open(const char *path) {
+    trace_file = fopen(path, "wb");
+    if (trace_file == NULL) return -1;
+    tracing = 1;
+    return 0;
+}
+
+/**
+ * trace_begin
+ * Write the header of a policy's run.
+ * @param policy  Policy name, truncated to 31 characters
+ * @param cpus    Number of simulated CPUs
+ */
+void trace_begin(const char *policy, int cpus) {
+    if (!tracing) return;
+    TraceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.cpus = cpus;
+    strncpy(header.policy, policy, sizeof(header.policy) - 1);
+    flush();
+    fwrite(&header, sizeof(header), 1, trace_file);
+}
+
+/**
+ * trace_write
+ * Buffer one record; see trace.h for what each field means per type.
+ */
+void trace_write(int type, int tid, int cpu, int start, int length, int arg) {
+    if (!tracing) return;
+    TraceRecord *record = &buffer[buffered++];
+    record->tid = tid;
+    record->cpu = cpu;
+    record->type = type;
+    record->pad = 0;
+    record->start = start;
+    record->length = length;
+    record->arg = arg;
+    if (buffered == TRACE_BUFFER) flush();
+}
+
+/**
+ * trace_end
+ * Close a run with a TRACE_END record and the task table, each name
+ * padded to TRACE_ALIGN bytes.
+ */
+void trace_end() {
+    if (!tracing) return;
+    trace_write(TRACE_END, metrics.count, 0, 0, 0, 0);
+    flush();
+    for (int i = 0; i < metrics.count; i++) {
+        TraceTask task;
+        task.priority = metrics.priority[i];
+        task.burst = metrics.burst[i];
+        task.arrival = metrics.arrival[i];
+        task.name_length = strlen(metrics.name[i]);
+        fwrite(&task, sizeof(task), 1, trace_file);
+        fwrite(metrics.name[i], 1, task.name_length, trace_file);
+        // keep every later record 4-byte aligned
+        static const char zeros[TRACE_ALIGN] = {0};
+        fwrite(zeros, 1, TRACE_NAME_PAD(task.name_length) - task.name_length, trace_file);
+    }
+}
+
+/**
+ * trace_close
+ * Flush and close the trace file.
+ */
+void trace_close() {
+    if (!tracing) return;
+    flush();
+    fclose(trace_file);
+    trace_file = NULL;
+    tracing = 0;
+}
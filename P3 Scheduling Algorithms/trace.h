@@ -0,0 +1,82 @@
+/**
+ * trace.h
+ * Binary schedule traces: fixed-size records of every slice, idle gap and
+ * migration, written by the simulator with --trace=file and read back by
+ * schedtrace.
+ *
+ * A file holds one run per policy. Each run is a TraceHeader, its records,
+ * a TRACE_END record whose tid is the task count, and then one TraceTask
+ * plus name bytes per task, in tid order. Names are zero-padded to
+ * TRACE_ALIGN bytes so every struct in the file stays aligned.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#define TRACE_MAGIC "SCHEDTRC"
+#define TRACE_VERSION 2
+
+// alignment of every header, record and task entry in the file
+#define TRACE_ALIGN 4
+
+// bytes a name of length n takes in the file, padding included
+#define TRACE_NAME_PAD(n) (((n) + TRACE_ALIGN - 1) & ~(TRACE_ALIGN - 1))
+
+// records buffered before each write
+#define TRACE_BUFFER 65536
+
+enum trace_type {
+    TRACE_RUN,          // tid ran on cpu for length units ending at start + length; arg is its burst left before
+    TRACE_IDLE,         // cpu idle for length units; tid is -1
+    TRACE_MIGRATE,      // tid moved to cpu from CPU arg, costing length units
+    TRACE_END           // end of a run's records; tid is the task count
+};
+
+typedef struct trace_header {
+    char magic[8];
+    int32_t version;
+    int32_t cpus;
+    char policy[32];
+} TraceHeader;
+
+typedef struct trace_record {
+    int32_t tid;
+    int16_t cpu;
+    uint8_t type;
+    uint8_t pad;
+    int32_t start;
+    int32_t length;
+    int32_t arg;
+} TraceRecord;
+
+typedef struct trace_task {
+    int32_t priority;
+    int32_t burst;
+    int32_t arrival;
+    int32_t name_length;    // name bytes that follow, no terminator or padding
+} TraceTask;
+
+// nonzero while per-slice text goes to stdout
+extern int trace_text;
+
+// nonzero while a trace file is open
+extern int tracing;
+
+// open a trace file; returns 0 on success
+int trace_open(const char *path);
+
+// start the records of a policy's run
+void trace_begin(const char *policy, int cpus);
+
+// append one record
+void trace_write(int type, int tid, int cpu, int start, int length, int arg);
+
+// end the current run and write its task table
+void trace_end();
+
+// flush and close the trace file
+void trace_close();
+
+#endif